@@ -0,0 +1,63 @@
+#include "BenchmarkSuite.h"
+using namespace std;
+
+BenchmarkSuite::BenchmarkSuite(unsigned int repetitions, string filter) {
+	m_repetitions = max(repetitions, 1u);
+	m_filter = filter;
+}
+
+bool BenchmarkSuite::isSelected(string group, string name) const {
+	return (group + "/" + name).find(m_filter) != string::npos;
+}
+
+void BenchmarkSuite::run(string group, string name, unsigned int items,
+		function<void()> body) {
+
+	if(!isSelected(group, name))
+		return;
+
+	cerr << group << "/" << name << "... " << flush;
+	body();
+
+	vector<double> times;
+	for(unsigned int i = 0; i < m_repetitions; i++) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		body();
+		times.push_back(chrono::duration<double, milli>(
+			chrono::steady_clock::now() - start).count());
+	}
+	sort(times.begin(), times.end());
+
+	Result result;
+	result.group = group;
+	result.name = name;
+	result.items = items;
+	result.minMs = times.front();
+	result.medianMs = times[times.size() / 2];
+	result.meanMs = 0.0;
+	for(unsigned int i = 0; i < times.size(); i++) {
+		result.meanMs += times[i] / times.size();
+	}
+	m_results.push_back(result);
+
+	cerr << result.medianMs << "ms" << endl;
+}
+
+void BenchmarkSuite::writeJson(ostream& os) const {
+	os << "{\"repetitions\": " << m_repetitions << ", \"results\": [";
+	for(unsigned int i = 0; i < m_results.size(); i++) {
+		const Result& result = m_results[i];
+		double itemsPerSecond = result.medianMs > 0.0 ?
+			result.items * 1000.0 / result.medianMs : 0.0;
+
+		os << (i ? "," : "") << endl << "\t{"
+			<< "\"group\": \"" << result.group << "\", "
+			<< "\"name\": \"" << result.name << "\", "
+			<< "\"items\": " << result.items << ", "
+			<< "\"minMs\": " << result.minMs << ", "
+			<< "\"medianMs\": " << result.medianMs << ", "
+			<< "\"meanMs\": " << result.meanMs << ", "
+			<< "\"itemsPerSecond\": " << itemsPerSecond << "}";
+	}
+	os << endl << "]}" << endl;
+}
@@ -0,0 +1,79 @@
+#ifndef BENCHMARK_SUITE_H
+#define BENCHMARK_SUITE_H
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Runs a set of timed cases and collects their results.
+ *
+ * Every case is run once to warm up and then a fixed number of times. The
+ * minimum, median and mean time of those runs are kept, along with the
+ * throughput based on the median. The results can be written as JSON, so
+ * they can be compared between releases.
+ */
+class BenchmarkSuite {
+public:
+	/**
+	 * @brief Initializes an empty suite.
+	 *
+	 * @param repetitions The number of timed runs of each case.
+	 * @param filter Only the cases whose full name contains this string are
+	 * run. An empty string runs every case.
+	 */
+	BenchmarkSuite(unsigned int repetitions, std::string filter);
+
+	/**
+	 * @brief Times one case.
+	 *
+	 * Progress is reported on the standard error stream.
+	 *
+	 * @param group The component being measured, such as "extractor".
+	 * @param name The name of the case inside its group.
+	 * @param items The number of items, such as images or descriptors,
+	 * processed by each run of @a body.
+	 * @param body The code to be timed.
+	 */
+	void run(std::string group, std::string name, unsigned int items,
+		std::function<void()> body);
+
+	/**
+	 * @brief Returns whether a case would be run by this suite.
+	 *
+	 * This allows the callers to skip any expensive setup for the cases
+	 * excluded by the filter.
+	 *
+	 * @param group The component being measured.
+	 * @param name The name of the case inside its group.
+	 * @return @a true if the case matches the filter.
+	 */
+	bool isSelected(std::string group, std::string name) const;
+
+	/**
+	 * @brief Writes the results of all the cases run so far as JSON.
+	 *
+	 * @param os The stream to write to.
+	 */
+	void writeJson(std::ostream& os) const;
+
+private:
+	struct Result {
+		std::string group;
+		std::string name;
+		unsigned int items;
+		double minMs;
+		double medianMs;
+		double meanMs;
+	};
+
+	unsigned int m_repetitions;
+	std::string m_filter;
+	std::vector<Result> m_results;
+};
+
+#endif
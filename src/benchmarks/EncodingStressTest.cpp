@@ -0,0 +1,164 @@
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+
+#include <omp.h>
+#include <boost/program_options.hpp>
+
+#include "features/SIFTFeatureExtractor.h"
+#include "features/HellingerFeatureTransform.h"
+#include "codebook/KMeansCodebookGenerator.h"
+#include "codebook/FisherCodebookGenerator.h"
+#include "benchmarks/SyntheticImages.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+// Features of several synthetic images, stored with the given precision
+vector<ImageFeatures*> extractFeatureSet(const SettingsManager* settings,
+		unsigned int numImages, unsigned int width, unsigned int height,
+		ImageFeatures::Storage storage) {
+
+	SIFTFeatureExtractor extractor(settings);
+	HellingerFeatureTransform transform(settings);
+
+	vector<ImageFeatures*> features;
+	for(unsigned int i = 0; i < numImages; i++) {
+		ImageData* img = createImage(width, height, 1, i % 4, i);
+		features.push_back(extractor.extract(img));
+		for(unsigned int j = 0; j < features[i]->getNumFeatures(); j++) {
+			transform.transform(features[i]->getMutableFeature(j),
+				features[i]->getDescriptorSize());
+		}
+		features[i]->compact(storage);
+		delete img;
+	}
+	return features;
+}
+
+bool isIdentical(const Histogram* a, const Histogram* b) {
+	return a->getLength() == b->getLength() && memcmp(a->getData(),
+		b->getData(), a->getLength() * sizeof(double)) == 0;
+}
+
+// Encodes every image several times from concurrent threads and counts the
+// histograms differing from a sequential pass. The encodings of one image are
+// consecutive, so the threads also share the same image at the same time
+unsigned int countMismatches(const Codebook* codebook,
+		const vector<ImageFeatures*>& features, unsigned int numThreads,
+		unsigned int rounds) {
+
+	vector<Histogram*> reference;
+	for(unsigned int i = 0; i < features.size(); i++) {
+		reference.push_back(codebook->encode(features[i]));
+	}
+
+	unsigned int mismatches = 0;
+	int numTasks = rounds * features.size();
+	#pragma omp parallel for schedule(dynamic) num_threads(numThreads) \
+		reduction(+:mismatches)
+	for(int i = 0; i < numTasks; i++) {
+		unsigned int image = i / rounds;
+		Histogram* histogram = codebook->encode(features[image]);
+		if(!isIdentical(histogram, reference[image])) {
+			mismatches++;
+		}
+		delete histogram;
+	}
+
+	for(unsigned int i = 0; i < reference.size(); i++) {
+		delete reference[i];
+	}
+	return mismatches;
+}
+
+int main(int argc, char** argv) {
+	unsigned int width, height, numImages, numThreads, rounds;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "print this message")
+		("settings", po::value<string>()->default_value("settings.json"),
+			"file containing all the classification parameters")
+		("width", po::value<unsigned int>(&width)->default_value(320),
+			"width of the generated images")
+		("height", po::value<unsigned int>(&height)->default_value(240),
+			"height of the generated images")
+		("images", po::value<unsigned int>(&numImages)->default_value(32),
+			"number of generated images")
+		("threads", po::value<unsigned int>(&numThreads)->default_value(
+			max(omp_get_max_threads(), 4)),
+			"number of threads encoding at the same time")
+		("rounds", po::value<unsigned int>(&rounds)->default_value(8),
+			"number of times each image is encoded concurrently")
+	;
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if(vm.count("help")) {
+		cout << desc << endl;
+		return 1;
+	}
+
+	SettingsManager settings(vm["settings"].as<string>());
+	settings.set("codebook.codewords", 32);
+	settings.set("codebook.pcaDimension", 32);
+	settings.set("codebook.totalFeatures", 20000);
+	settings.set("histogram.pyramidLevels", 2);
+
+	KMeansCodebookGenerator kmeans(&settings);
+	FisherCodebookGenerator fisher(&settings);
+	vector<pair<string, CodebookGenerator*> > generators;
+	generators.push_back(make_pair("KMeans", &kmeans));
+	generators.push_back(make_pair("Fisher", &fisher));
+
+	vector<pair<string, ImageFeatures::Storage> > storages;
+	storages.push_back(make_pair("Float32", ImageFeatures::FLOAT32));
+	storages.push_back(make_pair("Float16", ImageFeatures::FLOAT16));
+	storages.push_back(make_pair("UInt8", ImageFeatures::UINT8));
+
+	vector<ImageFeatures*> trainingFeatures = extractFeatureSet(&settings,
+		numImages, width, height, ImageFeatures::FLOAT32);
+	vector<unique_ptr<Codebook> > codebooks;
+	for(unsigned int i = 0; i < generators.size(); i++) {
+		codebooks.push_back(unique_ptr<Codebook>(
+			generators[i].second->generate(trainingFeatures)));
+		codebooks[i]->prepare();
+	}
+	for(unsigned int i = 0; i < trainingFeatures.size(); i++) {
+		delete trainingFeatures[i];
+	}
+
+	cout << setw(10) << "codebook" << setw(10) << "storage"
+		<< setw(12) << "encodings" << setw(12) << "mismatches" << endl;
+
+	unsigned int totalMismatches = 0;
+	for(unsigned int s = 0; s < storages.size(); s++) {
+		vector<ImageFeatures*> features = extractFeatureSet(&settings,
+			numImages, width, height, storages[s].second);
+
+		for(unsigned int i = 0; i < codebooks.size(); i++) {
+			unsigned int mismatches = countMismatches(codebooks[i].get(),
+				features, numThreads, rounds);
+			totalMismatches += mismatches;
+
+			cout << setw(10) << generators[i].first
+				<< setw(10) << storages[s].first
+				<< setw(12) << rounds * features.size()
+				<< setw(12) << mismatches << endl;
+		}
+
+		for(unsigned int i = 0; i < features.size(); i++) {
+			delete features[i];
+		}
+	}
+
+	if(totalMismatches > 0) {
+		cerr << "Concurrent encoding differs from a sequential pass" << endl;
+		return 1;
+	}
+	return 0;
+}
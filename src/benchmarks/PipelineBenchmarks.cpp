@@ -0,0 +1,404 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include "framework/ClassificationFramework.h"
+#include "benchmarks/BenchmarkSuite.h"
+#include "benchmarks/SyntheticImages.h"
+
+using namespace std;
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+// Features of several synthetic images, as used to build a codebook
+vector<ImageFeatures*> extractFeatureSet(const SettingsManager* settings,
+		unsigned int numImages, unsigned int width, unsigned int height) {
+
+	SIFTFeatureExtractor extractor(settings);
+	HellingerFeatureTransform transform(settings);
+
+	vector<ImageFeatures*> features;
+	for(unsigned int i = 0; i < numImages; i++) {
+		ImageData* img = createImage(width, height, 1, i % 4, i);
+		features.push_back(extractor.extract(img));
+		for(unsigned int j = 0; j < features[i]->getNumFeatures(); j++) {
+			transform.transform(features[i]->getMutableFeature(j),
+				features[i]->getDescriptorSize());
+		}
+		delete img;
+	}
+	return features;
+}
+
+// Writes a dataset with one texture pattern per class
+string generateDataset(string workPath, unsigned int numClasses,
+		unsigned int imagesPerClass, unsigned int width, unsigned int height) {
+
+	string datasetPath = workPath + "/dataset";
+	for(unsigned int c = 0; c < numClasses; c++) {
+		string classPath = datasetPath + "/class" + to_string(c);
+		fs::create_directories(classPath);
+		for(unsigned int i = 0; i < imagesPerClass; i++) {
+			ImageData* img = createImage(width, height, 3,
+				c, c * imagesPerClass + i);
+			saveImage(img, classPath + "/image" + to_string(i) + ".bmp");
+			delete img;
+		}
+	}
+	return datasetPath;
+}
+
+void benchmarkLoaders(BenchmarkSuite& suite, SettingsManager settings,
+		string workPath, unsigned int width, unsigned int height) {
+
+	string imagePath = workPath + "/loader.bmp";
+	ImageData* img = createImage(width, height, 3);
+	saveImage(img, imagePath);
+	delete img;
+
+	settings.set("image.forceSize", false);
+	settings.set("image.maxResolution", max(width, height));
+	GreyscaleImageLoader greyscale(&settings);
+	OpponentImageLoader opponent(&settings);
+	HSVImageLoader hsv(&settings);
+
+	vector<pair<string, ImageLoader*> > loaders;
+	loaders.push_back(make_pair("Greyscale", &greyscale));
+	loaders.push_back(make_pair("Opponent", &opponent));
+	loaders.push_back(make_pair("HSV", &hsv));
+	for(unsigned int i = 0; i < loaders.size(); i++) {
+		ImageLoader* loader = loaders[i].second;
+		suite.run("loader", loaders[i].first, 1, [&]() {
+			delete loader->loadImage(imagePath);
+		});
+	}
+
+	settings.set("image.maxResolution", max(width, height) / 2);
+	GreyscaleImageLoader resizing(&settings);
+	suite.run("loader", "Greyscale+resize", 1, [&]() {
+		delete resizing.loadImage(imagePath);
+	});
+}
+
+void benchmarkExtractors(BenchmarkSuite& suite, SettingsManager settings,
+		unsigned int width, unsigned int height) {
+
+	ImageData* img = createImage(width, height, 1);
+
+	settings.set("features.gridSpacing", vector<int>(1, 8));
+	settings.set("features.patchSize", vector<int>(1, 16));
+	SIFTFeatureExtractor sift(&settings);
+	HOGFeatureExtractor hog(&settings);
+	LBPFeatureExtractor lbp(&settings);
+	settings.set("features.lbpMapping", string("Uniform"));
+	LBPHistogramFeatureExtractor uniformLbp(&settings);
+	settings.set("features.lbpMapping", string("Rotation"));
+	LBPHistogramFeatureExtractor rotationLbp(&settings);
+
+	// Three scales, extracted separately and from a shared scale space
+	settings.set("features.gridSpacing", vector<int>(3, 8));
+	settings.set("features.patchSize", vector<int>({16, 24, 32}));
+	settings.set("features.multiScale", false);
+	SIFTFeatureExtractor siftScales(&settings);
+	settings.set("features.multiScale", true);
+	SIFTFeatureExtractor siftMultiScale(&settings);
+
+	vector<pair<string, FeatureExtractor*> > extractors;
+	extractors.push_back(make_pair("SIFT", &sift));
+	extractors.push_back(make_pair("HOG", &hog));
+	extractors.push_back(make_pair("LBP", &lbp));
+	extractors.push_back(make_pair("LBPHistogram-Uniform", &uniformLbp));
+	extractors.push_back(make_pair("LBPHistogram-Rotation", &rotationLbp));
+	extractors.push_back(make_pair("SIFT-3scales", &siftScales));
+	extractors.push_back(make_pair("SIFT-3scales-multiScale", &siftMultiScale));
+	for(unsigned int i = 0; i < extractors.size(); i++) {
+		FeatureExtractor* extractor = extractors[i].second;
+		suite.run("extractor", extractors[i].first, 1, [&]() {
+			delete extractor->extract(img);
+		});
+	}
+
+	delete img;
+}
+
+void benchmarkTransforms(BenchmarkSuite& suite, SettingsManager settings,
+		unsigned int width, unsigned int height) {
+
+	ImageData* img = createImage(width, height, 1);
+	SIFTFeatureExtractor extractor(&settings);
+	ImageFeatures* features = extractor.extract(img);
+	delete img;
+
+	HellingerFeatureTransform hellinger(&settings);
+	L2FeatureTransform l2(&settings);
+	settings.set("features.powerAlpha", 0.5f);
+	PowerFeatureTransform sqrtPower(&settings);
+	settings.set("features.powerAlpha", 0.3f);
+	PowerFeatureTransform power(&settings);
+
+	vector<pair<string, FeatureTransform*> > transforms;
+	transforms.push_back(make_pair("Hellinger", &hellinger));
+	transforms.push_back(make_pair("L2", &l2));
+	transforms.push_back(make_pair("Power-0.5", &sqrtPower));
+	transforms.push_back(make_pair("Power-0.3", &power));
+
+	// The transforms are applied in place, so every run keeps transforming
+	// the output of the previous one, which does not change their cost
+	unsigned int numFeatures = features->getNumFeatures();
+	unsigned int descriptorSize = features->getDescriptorSize();
+	for(unsigned int i = 0; i < transforms.size(); i++) {
+		FeatureTransform* transform = transforms[i].second;
+		suite.run("transform", transforms[i].first, numFeatures, [&]() {
+			for(unsigned int j = 0; j < numFeatures; j++) {
+				transform->transform(features->getMutableFeature(j),
+					descriptorSize);
+			}
+		});
+	}
+
+	delete features;
+}
+
+void benchmarkCodebooks(BenchmarkSuite& suite, SettingsManager settings,
+		unsigned int width, unsigned int height) {
+
+	settings.set("codebook.codewords", 32);
+	settings.set("codebook.pcaDimension", 32);
+	settings.set("codebook.totalFeatures", 20000);
+	settings.set("histogram.pyramidLevels", 2);
+	vector<ImageFeatures*> features =
+		extractFeatureSet(&settings, 16, width, height);
+
+	KMeansCodebookGenerator kmeans(&settings);
+	FisherCodebookGenerator fisher(&settings);
+
+	vector<pair<string, CodebookGenerator*> > generators;
+	generators.push_back(make_pair("KMeans", &kmeans));
+	generators.push_back(make_pair("Fisher", &fisher));
+	for(unsigned int i = 0; i < generators.size(); i++) {
+		CodebookGenerator* generator = generators[i].second;
+		string name = generators[i].first;
+		if(!suite.isSelected("codebook", name) &&
+				!suite.isSelected("encoder", name))
+			continue;
+
+		suite.run("codebook", name, 1, [&]() {
+			delete generator->generate(features);
+		});
+
+		unique_ptr<Codebook> codebook(generator->generate(features));
+		codebook->prepare();
+		suite.run("encoder", name, features.size(), [&]() {
+			for(unsigned int j = 0; j < features.size(); j++) {
+				delete codebook->encode(features[j]);
+			}
+		});
+	}
+
+	for(unsigned int i = 0; i < features.size(); i++) {
+		delete features[i];
+	}
+}
+
+void benchmarkClassifiers(BenchmarkSuite& suite, SettingsManager settings,
+		unsigned int numClasses) {
+
+	// Histograms of each class are centered on a different codeword
+	unsigned int histogramSize = 1024;
+	unsigned int histogramsPerClass = 50;
+	mt19937 generator(0);
+	uniform_real_distribution<double> noise(0.0, 0.1);
+
+	vector<string> classNames;
+	vector<Histogram*> histograms;
+	vector<unsigned int> classes;
+	for(unsigned int c = 0; c < numClasses; c++) {
+		classNames.push_back("class" + to_string(c));
+		for(unsigned int i = 0; i < histogramsPerClass; i++) {
+			vector<double> data(histogramSize);
+			for(unsigned int j = 0; j < histogramSize; j++) {
+				data[j] = noise(generator);
+			}
+			data[c * histogramSize / numClasses] += 1.0;
+			histograms.push_back(new Histogram(&data[0], histogramSize));
+			classes.push_back(c);
+		}
+	}
+
+	vector<string> types;
+	types.push_back("Linear");
+	types.push_back("SVM");
+	for(unsigned int i = 0; i < types.size(); i++) {
+		unique_ptr<Classifier> classifier(types[i] == "Linear" ?
+			(Classifier*) new LinearClassifier(&settings, classNames) :
+			(Classifier*) new SVMClassifier(&settings, classNames));
+
+		suite.run("classifier", types[i] + "-train", histograms.size(), [&]() {
+			classifier->train(histograms, classes);
+		});
+		suite.run("classifier", types[i] + "-classify", histograms.size(),
+			[&]() {
+				for(unsigned int j = 0; j < histograms.size(); j++) {
+					classifier->classify(histograms[j]);
+				}
+			});
+	}
+
+	for(unsigned int i = 0; i < histograms.size(); i++) {
+		delete histograms[i];
+	}
+}
+
+void benchmarkCache(BenchmarkSuite& suite, SettingsManager settings,
+		string workPath, unsigned int width, unsigned int height) {
+
+	string imagePath = workPath + "/cache.bmp";
+	ImageData* img = createImage(width, height, 1);
+	saveImage(img, imagePath);
+	delete img;
+
+	settings.set("image.forceSize", false);
+	settings.set("image.maxResolution", max(width, height));
+	settings.set("framework.verbose", false);
+	settings.set("framework.cacheData", true);
+	GreyscaleImageLoader loader(&settings);
+	SIFTFeatureExtractor extractor(&settings);
+	HellingerFeatureTransform transform(&settings);
+
+	// What a cache miss costs, as done by the framework
+	suite.run("cache", "recompute", 1, [&]() {
+		ImageData* image = loader.loadImage(imagePath);
+		ImageFeatures* features = extractor.extract(image);
+		for(unsigned int i = 0; i < features->getNumFeatures(); i++) {
+			transform.transform(features->getMutableFeature(i),
+				features->getDescriptorSize());
+		}
+		delete features;
+		delete image;
+	});
+
+	img = loader.loadImage(imagePath);
+	unique_ptr<ImageFeatures> features(extractor.extract(img));
+	delete img;
+
+	vector<pair<string, bool> > codecs;
+	codecs.push_back(make_pair("None", false));
+	codecs.push_back(make_pair("LZ4", false));
+	codecs.push_back(make_pair("LZ4", true));
+	codecs.push_back(make_pair("Zstd", false));
+	codecs.push_back(make_pair("Zstd", true));
+	for(unsigned int i = 0; i < codecs.size(); i++) {
+		string name = "read-" + codecs[i].first +
+			(codecs[i].second ? "+shuffle" : "");
+		if(!CacheCodec::isAvailable(CacheCodec::fromName(codecs[i].first)) ||
+				!suite.isSelected("cache", name))
+			continue;
+
+		// Each codec writes to its own cache, which is removed afterwards
+		settings.set("framework.cacheCompression", codecs[i].first);
+		settings.set("framework.cacheShuffle", codecs[i].second);
+		string datasetPath = workPath + "/cache-" + name;
+		CacheHelper cacheHelper(datasetPath, &settings);
+		cacheHelper.save<ImageFeatures>(imagePath, features.get());
+
+		uintmax_t entrySize = 0;
+		for(fs::recursive_directory_iterator it("cache/" + datasetPath);
+				it != fs::recursive_directory_iterator(); it++) {
+			if(fs::is_regular_file(it->path())) {
+				entrySize += fs::file_size(it->path());
+			}
+		}
+		cerr << "cache/" << name << ": " << entrySize << " bytes" << endl;
+
+		suite.run("cache", name, 1, [&]() {
+			delete cacheHelper.load<ImageFeatures>(imagePath);
+		});
+		fs::remove_all("cache/" + datasetPath);
+	}
+}
+
+void benchmarkEndToEnd(BenchmarkSuite& suite, SettingsManager settings,
+		string workPath, unsigned int numClasses, unsigned int imagesPerClass,
+		unsigned int width, unsigned int height) {
+
+	if(!suite.isSelected("endToEnd", "train+test"))
+		return;
+
+	string datasetPath = generateDataset(workPath, numClasses,
+		imagesPerClass, width, height);
+
+	// Nothing is cached, so every run goes through the whole pipeline
+	settings.set("framework.verbose", false);
+	settings.set("framework.cacheData", false);
+	settings.set("classifier.trainImagesPerClass", imagesPerClass / 2);
+	settings.set("codebook.textonImages", numClasses * imagesPerClass / 2);
+
+	suite.run("endToEnd", "train+test", numClasses * imagesPerClass, [&]() {
+		ClassificationFramework framework(datasetPath, &settings, true);
+		framework.train();
+		framework.testRun();
+	});
+
+	// The framework disables the standard output when it is not verbose
+	cout.clear();
+}
+
+int main(int argc, char** argv) {
+	unsigned int width, height, repetitions, numClasses, imagesPerClass;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "print this message")
+		("settings", po::value<string>()->default_value("settings.json"),
+			"file containing the base classification parameters")
+		("output", po::value<string>()->default_value("benchmarks.json"),
+			"file where the results are written, as JSON")
+		("filter", po::value<string>()->default_value(""),
+			"only run the cases whose group/name contains this string")
+		("work-path", po::value<string>()->default_value("benchmark-data"),
+			"folder where the generated images and dataset are written")
+		("width", po::value<unsigned int>(&width)->default_value(320),
+			"width of the generated images")
+		("height", po::value<unsigned int>(&height)->default_value(240),
+			"height of the generated images")
+		("repetitions", po::value<unsigned int>(&repetitions)->default_value(5),
+			"number of timed runs of each case")
+		("classes", po::value<unsigned int>(&numClasses)->default_value(4),
+			"number of classes of the generated dataset")
+		("images-per-class",
+			po::value<unsigned int>(&imagesPerClass)->default_value(20),
+			"number of images of each class of the generated dataset")
+	;
+
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+
+	if(vm.count("help")) {
+		cout << desc << endl;
+		return 1;
+	}
+
+	SettingsManager settings(vm["settings"].as<string>());
+	string workPath = vm["work-path"].as<string>();
+	fs::create_directories(workPath);
+
+	BenchmarkSuite suite(repetitions, vm["filter"].as<string>());
+	benchmarkLoaders(suite, settings, workPath, width, height);
+	benchmarkExtractors(suite, settings, width, height);
+	benchmarkTransforms(suite, settings, width, height);
+	benchmarkCodebooks(suite, settings, width, height);
+	benchmarkClassifiers(suite, settings, numClasses);
+	benchmarkCache(suite, settings, workPath, width, height);
+	benchmarkEndToEnd(suite, settings, workPath, numClasses, imagesPerClass,
+		width, height);
+
+	ofstream ofs(vm["output"].as<string>());
+	suite.writeJson(ofs);
+	return 0;
+}
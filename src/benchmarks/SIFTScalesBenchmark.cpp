@@ -0,0 +1,114 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include <boost/program_options.hpp>
+
+#include "features/SIFTFeatureExtractor.h"
+#include "benchmarks/SyntheticImages.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+// Average time taken to extract the features of one image, in milliseconds
+double timeExtraction(const SettingsManager* settings, const ImageData* img,
+		unsigned int repetitions) {
+	
+	SIFTFeatureExtractor extractor(settings);
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(unsigned int i = 0; i < repetitions; i++) {
+		delete extractor.extract(img);
+	}
+	return chrono::duration<double, milli>(
+		chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+// Same as timeExtraction(), but smoothing and processing every scale from
+// scratch with the PHOW smoothing, which is what the multi-scale mode computes
+double timeSeparatePhow(const vector<int>& gridSpacings,
+		const vector<int>& patchSizes, const ImageData* img,
+		unsigned int repetitions) {
+	
+	unsigned int width = img->getWidth();
+	unsigned int height = img->getHeight();
+	vector<float> smoothed(width * height);
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for(unsigned int r = 0; r < repetitions; r++) {
+		for(unsigned int h = 0; h < gridSpacings.size(); h++) {
+			unsigned int binSize = patchSizes[h] / 4.0;
+			double sigma = sqrt(max(0.0, pow(binSize / 6.0, 2) - 0.25));
+			
+			VlDsiftFilter* filter = vl_dsift_new_basic(width, height,
+				gridSpacings[h], binSize);
+			vl_dsift_set_flat_window(filter, true);
+			for(unsigned int i = 0; i < img->getNumChannels(); i++) {
+				vl_imsmooth_f(&smoothed[0], width, img->getData(i),
+					width, height, width, sigma, sigma);
+				vl_dsift_process(filter, &smoothed[0]);
+			}
+			vl_dsift_delete(filter);
+		}
+	}
+	return chrono::duration<double, milli>(
+		chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+int main(int argc, char** argv) {
+	unsigned int width, height, numChannels, maxScales, repetitions;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "print this message")
+		("settings", po::value<string>()->default_value("settings.json"),
+			"file containing all the classification parameters")
+		("width", po::value<unsigned int>(&width)->default_value(500),
+			"width of the test image")
+		("height", po::value<unsigned int>(&height)->default_value(375),
+			"height of the test image")
+		("channels", po::value<unsigned int>(&numChannels)->default_value(1),
+			"number of channels of the test image")
+		("max-scales", po::value<unsigned int>(&maxScales)->default_value(6),
+			"largest number of scales to measure")
+		("repetitions", po::value<unsigned int>(&repetitions)->default_value(5),
+			"number of extractions averaged for each measure")
+	;
+	
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+	
+	if(vm.count("help")) {
+		cout << desc << endl;
+		return 1;
+	}
+	
+	SettingsManager settings(vm["settings"].as<string>());
+	ImageData* img = createImage(width, height, numChannels);
+	
+	cout << setw(8) << "scales" << setw(16) << "default (ms)"
+		<< setw(16) << "phow (ms)" << setw(16) << "multiscale (ms)" << endl;
+	
+	// Every scale uses the same grid, with bin sizes of 4, 6, 8... pixels
+	vector<int> gridSpacings;
+	vector<int> patchSizes;
+	for(unsigned int numScales = 1; numScales <= maxScales; numScales++) {
+		gridSpacings.push_back(8);
+		patchSizes.push_back(8 + 8 * numScales);
+		settings.set("features.gridSpacing", gridSpacings);
+		settings.set("features.patchSize", patchSizes);
+		
+		settings.set("features.multiScale", false);
+		double defaultTime = timeExtraction(&settings, img, repetitions);
+		double phowTime = timeSeparatePhow(gridSpacings, patchSizes,
+			img, repetitions);
+		settings.set("features.multiScale", true);
+		double multiScaleTime = timeExtraction(&settings, img, repetitions);
+		
+		cout << setw(8) << numScales << setw(16) << defaultTime
+			<< setw(16) << phowTime << setw(16) << multiScaleTime << endl;
+	}
+	
+	delete img;
+	return 0;
+}
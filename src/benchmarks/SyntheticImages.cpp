@@ -0,0 +1,38 @@
+#include "SyntheticImages.h"
+using namespace std;
+using namespace cimg_library;
+
+ImageData* createImage(unsigned int width, unsigned int height,
+		unsigned int numChannels, unsigned int pattern, unsigned int seed) {
+	
+	mt19937 generator(seed);
+	uniform_real_distribution<float> noise(-8.0, 8.0);
+	double frequencyX = 0.05 * (1.0 + 0.3 * pattern);
+	double frequencyY = 0.07 / (1.0 + 0.2 * pattern);
+	
+	vector<float*> data;
+	for(unsigned int i = 0; i < numChannels; i++) {
+		data.push_back(new float[width * height]);
+		for(unsigned int y = 0; y < height; y++) {
+			for(unsigned int x = 0; x < width; x++) {
+				float value = 127.5 + 119.5 * sin(x * frequencyX * (i + 1)) *
+					cos(y * frequencyY) * ((x ^ y) & 7) / 7.0;
+				data[i][y * width + x] = value + noise(generator);
+			}
+		}
+	}
+	return new ImageData(data, width, height);
+}
+
+void saveImage(const ImageData* img, string filename) {
+	CImg<float> image(img->getWidth(), img->getHeight(), 1,
+		img->getNumChannels());
+	for(unsigned int i = 0; i < img->getNumChannels(); i++) {
+		for(unsigned int y = 0; y < img->getHeight(); y++) {
+			for(unsigned int x = 0; x < img->getWidth(); x++) {
+				image(x, y, 0, i) = img->getData(i)[y * img->getWidth() + x];
+			}
+		}
+	}
+	image.save(filename.c_str());
+}
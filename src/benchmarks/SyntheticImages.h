@@ -0,0 +1,39 @@
+#ifndef SYNTHETIC_IMAGES_H
+#define SYNTHETIC_IMAGES_H
+
+#include <cmath>
+#include <random>
+#include <string>
+
+#define cimg_display 0
+#include <CImg.h>
+
+#include "images/ImageData.h"
+
+/**
+ * @brief Creates a textured image, so the descriptors are not all empty.
+ *
+ * Images created with the same @a pattern share the same texture frequencies
+ * and only differ on their noise, which makes them usable as the images of
+ * one class of a generated dataset.
+ *
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param numChannels The number of channels of the image.
+ * @param pattern Selects the frequencies of the texture.
+ * @param seed Seed of the noise added to the texture.
+ * @return The image data, with values between 0 and 255.
+ */
+ImageData* createImage(unsigned int width, unsigned int height,
+	unsigned int numChannels, unsigned int pattern = 0,
+	unsigned int seed = 0);
+
+/**
+ * @brief Saves an image to a file, in a format chosen by its extension.
+ *
+ * @param img The image to be saved.
+ * @param filename The location of the file.
+ */
+void saveImage(const ImageData* img, std::string filename);
+
+#endif
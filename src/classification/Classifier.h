@@ -3,8 +3,16 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
 
 #include "codebook/Histogram.h"
+#include "classification/TrainingMatrix.h"
 
 /**
  * @brief Contains the image classifier.
@@ -23,14 +31,50 @@ public:
 	 * the highest response value is the one used as the classification for an
 	 * image.
 	 *
+	 * The classifier keeps a reference to the matrix if it needs the training
+	 * images to classify others.
+	 *
+	 * @param trainingData Histograms and classes of the images to be used as
+	 * training data. The class is a number that corresponds to its index in
+	 * the @a classNames vector.
+	 */
+	virtual void train(
+		std::shared_ptr<const TrainingMatrix> trainingData) = 0;
+
+	/**
+	 * @brief Trains the classifier from separate histograms.
+	 *
+	 * The histograms are copied into a @a TrainingMatrix, so they can be
+	 * deleted afterwards.
+	 *
 	 * @param histograms Histograms of the images to be used as training data.
 	 * @param imageClasses Class of each image. Each element in this vector must
 	 * match the element in the @a histograms vector at the same position.
-	 * The class is a number that corresponds to its index in the @a classNames
-	 * vector.
 	 */
-	virtual void train(std::vector<Histogram*> histograms,
-		std::vector<unsigned int> imageClasses) = 0;
+	void train(const std::vector<Histogram*>& histograms,
+			const std::vector<unsigned int>& imageClasses) {
+
+		train(std::make_shared<const TrainingMatrix>(
+			histograms, imageClasses));
+	}
+
+	/**
+	 * @brief Refines the trained classifier with new images.
+	 *
+	 * The existing model is updated from the new images only, which is much
+	 * faster than training it again with all of them. Classifiers which do
+	 * not support this throw an exception.
+	 *
+	 * @pre The classifier must be trained using train()
+	 *
+	 * @param histograms Histograms of the new images.
+	 * @param imageClasses Class of each new image, as in train().
+	 */
+	virtual void update(std::vector<Histogram*> histograms,
+			std::vector<unsigned int> imageClasses) {
+
+		throw std::logic_error("classifier does not support updates");
+	}
 		
 	/**
 	 * @brief Classifies a single image.
@@ -47,6 +91,39 @@ public:
 	 * their class.
 	 */
 	virtual std::pair<unsigned int, double> classify(Histogram* histogram) = 0;
+	
+	/**
+	 * @brief Ranks every class for a single image.
+	 *
+	 * @param histogram Histogram of the image to be classified.
+	 * @return One pair per class, containing its index and decision value,
+	 * ordered from the most to the least probable class. The first pair is
+	 * the one returned by classify().
+	 */
+	virtual std::vector<std::pair<unsigned int, double> > rank(
+		Histogram* histogram) = 0;
+
+protected:
+	/**
+	 * @brief Chooses how many one-vs-all classifiers are trained at once.
+	 *
+	 * @param requested The number of workers given in the settings, where 0
+	 * uses every core.
+	 * @param numClasses The number of classes to be trained.
+	 * @return The number of workers, at least 1 and at most @a numClasses.
+	 */
+	static unsigned int getNumWorkers(unsigned int requested,
+			unsigned int numClasses) {
+
+#ifdef _OPENMP
+		if(requested == 0) {
+			requested = omp_get_max_threads();
+		}
+#else
+		requested = 1;
+#endif
+		return std::max(1u, std::min(requested, numClasses));
+	}
 };
 
 #endif
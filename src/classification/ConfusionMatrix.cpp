@@ -2,46 +2,74 @@
 using namespace std;
 
 ConfusionMatrix::ConfusionMatrix(vector<string> classNames) {
-	isNormalized = false;
 	m_classNames = classNames;
-	m_confusionMatrix.resize(
-		boost::extents[classNames.size()][classNames.size()]);
+	m_counts.resize(boost::extents[classNames.size()][classNames.size()]);
+	fill(m_counts.data(), m_counts.data() + m_counts.num_elements(), 0);
 }
 
-void ConfusionMatrix::addEntry(
-		unsigned int originalClass, unsigned int predictedClass) {
+void ConfusionMatrix::addEntry(unsigned int originalClass,
+		unsigned int predictedClass, unsigned int count) {
 
-	m_confusionMatrix[originalClass][predictedClass]++;
-	isNormalized = false;
+	m_counts[originalClass][predictedClass] += count;
 }
 
-void ConfusionMatrix::normalize() {
-	for(unsigned int i = 0; i < m_classNames.size(); i++) {
-		double lineTotal = 0;
-		for(unsigned int j = 0; j < m_classNames.size(); j++) {
-			lineTotal += m_confusionMatrix[i][j];
-		}
-		
-		for(unsigned int j = 0; j < m_classNames.size(); j++) {
-			m_confusionMatrix[i][j] /= lineTotal;
-		}
+unsigned int ConfusionMatrix::getClassTotal(unsigned int classIndex) const {
+	unsigned int total = 0;
+	for(unsigned int j = 0; j < m_classNames.size(); j++) {
+		total += m_counts[classIndex][j];
 	}
-	isNormalized = true;
+	return total;
 }
 
-double ConfusionMatrix::getDiagonalAverage() {
-	if(!isNormalized)
-		normalize();
+unsigned int ConfusionMatrix::getPredictedTotal(
+		unsigned int classIndex) const {
 
+	unsigned int total = 0;
+	for(unsigned int i = 0; i < m_classNames.size(); i++) {
+		total += m_counts[i][classIndex];
+	}
+	return total;
+}
+
+double ConfusionMatrix::getDiagonalAverage() const {
 	double total = 0;
 	for(unsigned int i = 0; i < m_classNames.size(); i++) {
-		total += m_confusionMatrix[i][i];
+		total += getRecall(i);
 	}
 	return total / m_classNames.size();
 }
 
-void ConfusionMatrix::printMatrix() {
-	if(!isNormalized)
-		normalize();
-	OutputHelper::printConfusionMatrix(m_classNames, m_confusionMatrix);
+double ConfusionMatrix::getPrecision(unsigned int classIndex) const {
+	unsigned int predicted = getPredictedTotal(classIndex);
+	return predicted == 0 ?
+		0.0 : m_counts[classIndex][classIndex] / (double) predicted;
+}
+
+double ConfusionMatrix::getRecall(unsigned int classIndex) const {
+	unsigned int total = getClassTotal(classIndex);
+	return total == 0 ?
+		0.0 : m_counts[classIndex][classIndex] / (double) total;
+}
+
+void ConfusionMatrix::printMatrix() const {
+	unsigned int numClasses = m_classNames.size();
+	boost::multi_array<float, 2> normalized(
+		boost::extents[numClasses][numClasses]);
+	for(unsigned int i = 0; i < numClasses; i++) {
+		unsigned int total = getClassTotal(i);
+		for(unsigned int j = 0; j < numClasses; j++) {
+			normalized[i][j] = total == 0 ?
+				0.0f : m_counts[i][j] / (float) total;
+		}
+	}
+	OutputHelper::printConfusionMatrix(m_classNames, normalized);
+}
+
+void ConfusionMatrix::printClassMetrics() const {
+	vector<double> precision, recall;
+	for(unsigned int i = 0; i < m_classNames.size(); i++) {
+		precision.push_back(getPrecision(i));
+		recall.push_back(getRecall(i));
+	}
+	OutputHelper::printClassMetrics(m_classNames, precision, recall);
 }
@@ -8,12 +8,14 @@
 /**
  * @brief Gathers and shows the results of the image classification process.
  *
- * After adding all the results of the testing of a classifier, this matrix,
- * relating the image's predicted class and the expected result, will be
- * normalized.
- * Each element of the matrix represents the percentage of images of a class
- * (the row) got classified as another class (the column). The diagonal shows
- * the percentage of correctly classified images.
+ * The matrix counts how many images of each class (the row) got classified as
+ * every class (the column). When shown, each row is normalized so that its
+ * elements represent the percentage of images of that class. The diagonal
+ * shows the percentage of correctly classified images.
+ *
+ * The counts are never modified by the normalization, so entries can be added
+ * at any time. Adding entries is not thread-safe, EvaluationAccumulator should
+ * be used to gather the results of parallel loops.
  */
 class ConfusionMatrix {
 public:
@@ -31,14 +33,12 @@ public:
 	 * The classes should be the index to the @a classNames vector defined
 	 * when the confusion matrix was constructed.
 	 *
-	 * @warning Once the diagonal average or the final matrix is printed, the
-	 * data will be normalized and no more data should be added using
-	 * this function.
-	 *
 	 * @param originalClass The expected result.
 	 * @param predictedClass The result obtained by using the classifier.
+	 * @param count How many images had this result.
 	 */
-	void addEntry(unsigned int originalClass, unsigned int predictedClass);
+	void addEntry(unsigned int originalClass, unsigned int predictedClass,
+		unsigned int count = 1);
 	
 	/**
 	 * @brief Calculates the average of the matrix diagonal.
@@ -50,18 +50,45 @@ public:
 	 * @return The average value of the matrix diagonal. This is a percentage,
 	 * between 0 and 1.
 	 */
-	double getDiagonalAverage();
+	double getDiagonalAverage() const;
+	
+	/**
+	 * @brief Calculates the precision of one class.
+	 *
+	 * @param classIndex The index of the class in the @a classNames vector.
+	 * @return The ratio of the images classified as this class that really
+	 * belong to it, or 0 if no image was classified as this class.
+	 */
+	double getPrecision(unsigned int classIndex) const;
+	
+	/**
+	 * @brief Calculates the recall of one class.
+	 *
+	 * This is the same value shown in the diagonal of the matrix.
+	 *
+	 * @param classIndex The index of the class in the @a classNames vector.
+	 * @return The ratio of the images of this class that were classified
+	 * correctly, or 0 if there are no images of this class.
+	 */
+	double getRecall(unsigned int classIndex) const;
 	
 	/**
 	 * @brief Prints the confusion matrix to the standard output.
 	 */
-	void printMatrix();	
+	void printMatrix() const;
+	
+	/**
+	 * @brief Prints the precision and recall of each class to the standard
+	 * output.
+	 */
+	void printClassMetrics() const;
+	
 private:
-	boost::multi_array<float, 2> m_confusionMatrix;
+	boost::multi_array<unsigned int, 2> m_counts;
 	std::vector<std::string> m_classNames;
-	bool isNormalized;
 	
-	void normalize();
+	unsigned int getClassTotal(unsigned int classIndex) const;
+	unsigned int getPredictedTotal(unsigned int classIndex) const;
 };
 
 #endif
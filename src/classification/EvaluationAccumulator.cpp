@@ -0,0 +1,90 @@
+#include "EvaluationAccumulator.h"
+using namespace std;
+
+// Number of counters in a cache line, partials are padded to a multiple of it
+static const unsigned int COUNTERS_PER_LINE = 64 / sizeof(uint64_t);
+
+EvaluationAccumulator::EvaluationAccumulator(vector<string> classNames,
+		unsigned int maxRank) {
+
+	m_classNames = classNames;
+	m_maxRank = min<unsigned int>(maxRank, classNames.size());
+
+	unsigned int numClasses = classNames.size();
+	unsigned int numCounters = numClasses * numClasses + numClasses * m_maxRank;
+	m_partialStride = (numCounters + COUNTERS_PER_LINE - 1) /
+		COUNTERS_PER_LINE * COUNTERS_PER_LINE;
+
+#ifdef _OPENMP
+	m_numPartials = omp_get_max_threads();
+#else
+	m_numPartials = 1;
+#endif
+	m_partials.resize(m_numPartials * m_partialStride, 0);
+}
+
+void EvaluationAccumulator::addEntry(unsigned int originalClass,
+		const vector<pair<unsigned int, double> >& ranking) {
+
+#ifdef _OPENMP
+	unsigned int partial = omp_get_thread_num() % m_numPartials;
+#else
+	unsigned int partial = 0;
+#endif
+	uint64_t* counters = &m_partials[partial * m_partialStride];
+
+	// The updates are atomic in case a thread shares its partial with
+	// another, such as in nested loops. Without contention they are cheap.
+	uint64_t& count = counters[countOffset(originalClass, ranking[0].first)];
+	#pragma omp atomic
+	count++;
+
+	for(unsigned int r = 0; r < min<size_t>(m_maxRank, ranking.size()); r++) {
+		if(ranking[r].first == originalClass) {
+			uint64_t& hits = counters[rankOffset(originalClass, r)];
+			#pragma omp atomic
+			hits++;
+			break;
+		}
+	}
+}
+
+uint64_t EvaluationAccumulator::sumPartials(unsigned int offset) const {
+	uint64_t total = 0;
+	for(unsigned int i = 0; i < m_numPartials; i++) {
+		uint64_t value;
+		#pragma omp atomic read
+		value = m_partials[i * m_partialStride + offset];
+		total += value;
+	}
+	return total;
+}
+
+ConfusionMatrix EvaluationAccumulator::getConfusionMatrix() const {
+	ConfusionMatrix confMat(m_classNames);
+	for(unsigned int i = 0; i < m_classNames.size(); i++) {
+		for(unsigned int j = 0; j < m_classNames.size(); j++) {
+			confMat.addEntry(i, j, sumPartials(countOffset(i, j)));
+		}
+	}
+	return confMat;
+}
+
+double EvaluationAccumulator::getTopAccuracy(unsigned int k) const {
+	k = min(k, m_maxRank);
+
+	double total = 0.0;
+	for(unsigned int i = 0; i < m_classNames.size(); i++) {
+		uint64_t classTotal = 0;
+		for(unsigned int j = 0; j < m_classNames.size(); j++) {
+			classTotal += sumPartials(countOffset(i, j));
+		}
+
+		uint64_t hits = 0;
+		for(unsigned int r = 0; r < k; r++) {
+			hits += sumPartials(rankOffset(i, r));
+		}
+		total += classTotal == 0 ? 0.0 : hits / (double) classTotal;
+	}
+	return total / m_classNames.size();
+}
@@ -0,0 +1,102 @@
+#ifndef EVALUATION_ACCUMULATOR_H
+#define EVALUATION_ACCUMULATOR_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+#include "classification/ConfusionMatrix.h"
+
+/**
+ * @brief Gathers the classification results of a parallel loop.
+ *
+ * Each OpenMP thread counts its results in its own integer partials, kept on
+ * separate cache lines, so the threads never wait for each other. The
+ * partials are only merged when the results are requested, which can be done
+ * at the end or while the loop is still running.
+ *
+ * Besides the confusion matrix, the rank of the expected class among the
+ * classifier's ranking is kept, which allows calculating the top-k accuracy.
+ */
+class EvaluationAccumulator {
+public:
+	/**
+	 * @brief Initializes the accumulator with no results.
+	 *
+	 * @param classNames A vector with the names of each class.
+	 * @param maxRank The largest @a k for which the top-k accuracy
+	 * is kept.
+	 */
+	EvaluationAccumulator(std::vector<std::string> classNames,
+		unsigned int maxRank = 5);
+
+	/**
+	 * @brief Adds the result of one image.
+	 *
+	 * This can be called concurrently from the threads of an OpenMP loop.
+	 *
+	 * @param originalClass The expected class.
+	 * @param ranking The classes ranked by the classifier, from the most to
+	 * the least probable, as returned by Classifier::rank(). The first class
+	 * is the predicted one.
+	 */
+	void addEntry(unsigned int originalClass,
+		const std::vector<std::pair<unsigned int, double> >& ranking);
+
+	/**
+	 * @brief Merges the results added so far into a confusion matrix.
+	 *
+	 * @return The confusion matrix of all the results.
+	 */
+	ConfusionMatrix getConfusionMatrix() const;
+
+	/**
+	 * @brief Calculates the top-k accuracy of the results added so far.
+	 *
+	 * An image is correct if its class is among the @a k first classes of
+	 * its ranking. As with ConfusionMatrix::getDiagonalAverage(), the
+	 * accuracy of each class is averaged, so the top-1 accuracy is the same
+	 * as the diagonal average.
+	 *
+	 * @param k The number of classes considered, up to @a maxRank.
+	 * @return The average top-k accuracy of the classes, between 0 and 1.
+	 */
+	double getTopAccuracy(unsigned int k) const;
+
+	/**
+	 * @brief Provides the largest @a k for which the top-k accuracy is kept.
+	 *
+	 * @return The @a maxRank given to the constructor, limited by the number
+	 * of classes.
+	 */
+	unsigned int getMaxRank() const {
+		return m_maxRank;
+	}
+
+private:
+	std::vector<std::string> m_classNames;
+	unsigned int m_maxRank;
+	unsigned int m_numPartials;
+	unsigned int m_partialStride;
+	std::vector<uint64_t> m_partials;
+
+	unsigned int countOffset(unsigned int originalClass,
+		unsigned int predictedClass) const {
+		return originalClass * m_classNames.size() + predictedClass;
+	}
+
+	unsigned int rankOffset(unsigned int originalClass,
+		unsigned int rank) const {
+		return m_classNames.size() * m_classNames.size() +
+			originalClass * m_maxRank + rank;
+	}
+
+	uint64_t sumPartials(unsigned int offset) const;
+};
+
+#endif
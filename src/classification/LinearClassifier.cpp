@@ -7,103 +7,271 @@ LinearClassifier::LinearClassifier(const SettingsManager* settings,
 	linear::set_print_string_function(&printLinear);
 	
 	m_c = settings->get<float>("classifier.c");
+	m_numWorkers = settings->get<unsigned int>("classifier.workers", 0);
+	m_updateEpochs = settings->get<unsigned int>("classifier.updateEpochs", 1);
+	m_seed = settings->get<uint64_t>("framework.seed", 0);
+	m_parallelDual = settings->get<bool>("classifier.parallelDual", false);
 	m_classNames = classNames;
-	m_svmParams = nullptr;
-	m_svmProb = nullptr;
-	m_svmModel = nullptr;
+	m_numWeights = 0;
+	m_numSamples = 0;
+
+	// The dual solvers use the default tolerance of LIBLINEAR
+	string solver = settings->get<string>("classifier.solver", "LR");
+	if(solver == "LR") {
+		m_solverType = linear::L2R_LR;
+		m_eps = 1e-4;
+	} else if(solver == "LRDual") {
+		m_solverType = linear::L2R_LR_DUAL;
+		m_eps = 0.1;
+	} else if(solver == "L2LossDual") {
+		m_solverType = linear::L2R_L2LOSS_SVC_DUAL;
+		m_eps = 0.1;
+	} else if(solver == "L1LossDual") {
+		m_solverType = linear::L2R_L1LOSS_SVC_DUAL;
+		m_eps = 0.1;
+	} else {
+		throw runtime_error("unknown linear solver " + solver);
+	}
 }
 
-LinearClassifier::~LinearClassifier() {
-	clearData();
+void LinearClassifier::trainClass(unsigned int desiredClass,
+		linear::feature_node** data, unsigned int descriptorLength,
+		const vector<unsigned int>& imageClasses) {
+
+	vector<int> classes(imageClasses.size());
+	for(unsigned int i = 0; i < imageClasses.size(); i++) {
+		classes[i] = imageClasses[i] == desiredClass ? 1 : -1;
+	}
+
+	linear::problem svmProb;
+	svmProb.l = imageClasses.size();
+	svmProb.n = descriptorLength + 1;
+	svmProb.y = &classes[0];
+	svmProb.x = data;
+	svmProb.bias = 1;
+
+	linear::parameter svmParams = linear::parameter();
+	svmParams.solver_type = m_solverType;
+	svmParams.C = m_c;
+	svmParams.eps = m_eps;
+
+	if(isDual()) {
+		CounterRandom random(m_seed, CounterRandom::SOLVER_SHUFFLE);
+		srand((unsigned int) random(desiredClass));
+	}
+	linear::model* model = linear::train(&svmProb, &svmParams);
+
+	// The weights favour the first label found in the training data
+	double sign = model->label[0] == 1 ? 1.0 : -1.0;
+	double* weights = &m_weights[desiredClass * m_numWeights];
+	for(unsigned int j = 0; j < m_numWeights; j++) {
+		weights[j] = sign * model->w[j];
+	}
+	linear::free_and_destroy_model(&model);
 }
 
-void LinearClassifier::clearData() {
-	if(m_svmModel != nullptr) {
-		linear::free_and_destroy_model(&m_svmModel);
-		m_svmModel = nullptr;
+void LinearClassifier::train(shared_ptr<const TrainingMatrix> trainingData) {
+	OutputHelper::printMessage("Training Classifier:");
+
+	// LIBLINEAR reads its own nodes, which are only kept while training
+	unsigned int numImages = trainingData->getNumRows();
+	unsigned int descriptorLength = trainingData->getNumColumns();
+	const vector<unsigned int>& imageClasses = trainingData->getClasses();
+	vector<linear::feature_node> nodes(
+		(size_t) numImages * (descriptorLength + 2));
+	vector<linear::feature_node*> data(numImages);
+
+	{
+		ProgressTracker progress("Calculating kernel matrix", numImages);
+		#pragma omp parallel for
+		for(unsigned int i = 0; i < numImages; i++) {
+			const float* row = trainingData->getRow(i);
+			data[i] = &nodes[(size_t) i * (descriptorLength + 2)];
+			for(unsigned int j = 0; j < descriptorLength; j++) {
+				data[i][j].index = j + 1;
+				data[i][j].value = row[j];
+			}
+			data[i][descriptorLength].index = descriptorLength + 1;
+			data[i][descriptorLength].value = 1.0;
+			data[i][descriptorLength + 1].index = -1;
+			progress.increment();
+		}
 	}
-	
-	if(m_svmProb != nullptr) {
-		for(int i = 0; i < m_svmProb->l; i++) {
-			delete[] m_svmProb->x[i];
+
+	m_numSamples = numImages;
+	m_numWeights = descriptorLength + 1;
+	m_weights.assign(m_classNames.size() * m_numWeights, 0.0);
+	m_trained.assign(m_classNames.size(), false);
+	for(unsigned int i = 0; i < imageClasses.size(); i++) {
+		m_trained[imageClasses[i]] = true;
+	}
+
+	// The data is only read, so every class is trained at the same time
+	// from the same nodes, unless the solver shuffles with rand() and must be
+	// reproducible
+	unsigned int numWorkers = isDual() && !m_parallelDual ?
+		1 : getNumWorkers(m_numWorkers, m_classNames.size());
+	exception_ptr error;
+	{
+		ProgressTracker progress("Generating models", m_classNames.size());
+		#pragma omp parallel for schedule(dynamic) num_threads(numWorkers)
+		for(unsigned int i = 0; i < m_classNames.size(); i++) {
+			try {
+				if(m_trained[i]) {
+					trainClass(i, &data[0], descriptorLength, imageClasses);
+				}
+			} catch(...) {
+				#pragma omp critical
+				if(!error) {
+					error = current_exception();
+				}
+			}
+			progress.increment();
 		}
-		delete[] m_svmProb->x;
-		
-		delete m_svmProb;
-		m_svmProb = nullptr;
 	}
 
-	if(m_svmParams != nullptr) {
-		delete m_svmParams;
-		m_svmParams = nullptr;
+	if(error) {
+		rethrow_exception(error);
+	}
+}
+
+double LinearClassifier::lossGradient(double margin) const {
+	switch(m_solverType) {
+		case linear::L2R_LR:
+		case linear::L2R_LR_DUAL:
+			return 1.0 / (1.0 + exp(margin));
+		case linear::L2R_L2LOSS_SVC_DUAL:
+			return max(0.0, 2.0 * (1.0 - margin));
+		default:
+			return margin < 1.0 ? 1.0 : 0.0;
+	}
+}
+
+void LinearClassifier::updateClass(unsigned int desiredClass,
+		const vector<vector<float> >& rows,
+		const vector<unsigned int>& imageClasses) {
+
+	// LIBLINEAR minimizes |w|^2 / 2 + C * sum(loss), which is the Pegasos
+	// objective with lambda = 1 / (C * n). The step size continues from the
+	// images already learned, so the first new images do not undo the
+	// current model.
+	double lambda = 1.0 / (m_c * m_numSamples);
+	unsigned int step = m_numSamples - rows.size();
+	unsigned int histLength = m_numWeights - 1;
+	double* weights = &m_weights[desiredClass * m_numWeights];
+
+	for(unsigned int epoch = 0; epoch < m_updateEpochs; epoch++) {
+		for(unsigned int i = 0; i < rows.size(); i++) {
+			const vector<float>& data = rows[i];
+			double label = imageClasses[i] == desiredClass ? 1.0 : -1.0;
+			double value = weights[histLength];
+			for(unsigned int k = 0; k < histLength; k++) {
+				value += weights[k] * data[k];
+			}
+
+			double rate = 1.0 / (lambda * ++step);
+			double shrink = 1.0 - rate * lambda;
+			double gradient = rate * label * lossGradient(label * value);
+			double sqNorm = 0.0;
+			for(unsigned int k = 0; k < histLength; k++) {
+				weights[k] = shrink * weights[k] + gradient * data[k];
+				sqNorm += weights[k] * weights[k];
+			}
+			weights[histLength] = shrink * weights[histLength] + gradient;
+			sqNorm += weights[histLength] * weights[histLength];
+
+			// The optimal weights always lie within this radius
+			double scale = 1.0 / sqrt(lambda * sqNorm);
+			if(scale < 1.0) {
+				for(unsigned int k = 0; k < m_numWeights; k++) {
+					weights[k] *= scale;
+				}
+			}
+		}
 	}
 }
 
-void LinearClassifier::train(vector<Histogram*> histograms,
+void LinearClassifier::update(vector<Histogram*> histograms,
 		vector<unsigned int> imageClasses) {
-	
-	clearData();
-	
-	OutputHelper::printMessage("Training Classifier:");
 
-	m_svmParams = new linear::parameter();
-	m_svmParams->solver_type = linear::L2R_LR;
-	m_svmParams->C = m_c;
-	m_svmParams->eps = 1e-4;
+	if(m_numWeights == 0) {
+		throw logic_error("classifier was not trained");
+	}
 
-	unsigned int descriptorLength = histograms[0]->getLength();
-	linear::feature_node** kernel =
-		new linear::feature_node*[histograms.size()];
+	OutputHelper::printMessage("Updating Classifier:");
 
-	unsigned int currentIter = 0;
-	#pragma omp parallel for
+	m_numSamples += histograms.size();
+	for(unsigned int i = 0; i < imageClasses.size(); i++) {
+		m_trained[imageClasses[i]] = true;
+	}
+	
+	// The same values the classifier was trained on
+	vector<vector<float> > rows;
 	for(unsigned int i = 0; i < histograms.size(); i++) {
-		kernel[i] = new linear::feature_node[descriptorLength + 2];
-		for(unsigned int j = 0; j < descriptorLength; j++) {				
-			kernel[i][j].index = j + 1;
-			kernel[i][j].value = histograms[i]->getData()[j];
-		}
-		kernel[i][descriptorLength].index = descriptorLength + 1;
-		kernel[i][descriptorLength].value = 1.0;
-		kernel[i][descriptorLength + 1].index = -1;
-		
-		#pragma omp critical
-		{
-			currentIter++;
-			OutputHelper::printProgress("Calculating kernel matrix",
-				currentIter, histograms.size());
+		rows.push_back(TrainingMatrix::toRow(histograms[i]));
+	}
+
+	// Each class only changes its own weights
+	unsigned int numWorkers =
+		getNumWorkers(m_numWorkers, m_classNames.size());
+	ProgressTracker progress("Updating models", m_classNames.size());
+	#pragma omp parallel for schedule(dynamic) num_threads(numWorkers)
+	for(unsigned int i = 0; i < m_classNames.size(); i++) {
+		if(m_trained[i]) {
+			updateClass(i, rows, imageClasses);
 		}
+		progress.increment();
 	}
-	
-	vector<int> newClasses(imageClasses.begin(), imageClasses.end());
-	m_svmProb = new linear::problem();
-	m_svmProb->l = histograms.size();
-	m_svmProb->n = descriptorLength + 1;
-	m_svmProb->y = &newClasses[0];
-	m_svmProb->x = kernel;
-	m_svmProb->bias = 1;
-	
-	m_svmModel = linear::train(m_svmProb, m_svmParams);
-	cout << endl;
 }
 
 pair<unsigned int, double> LinearClassifier::classify(Histogram* histogram) {
-	const unsigned int histLength = histogram->getLength();
-	linear::feature_node testNode[histLength + 2];
+	return rank(histogram).front();
+}
 
+vector<pair<unsigned int, double> > LinearClassifier::rank(
+		Histogram* histogram) {
+		
+	const vector<float> data = TrainingMatrix::toRow(histogram);
+	const unsigned int histLength = data.size();
+
+	vector<double> values(m_classNames.size(), 0.0);
 	#pragma omp parallel for
-	for(unsigned int j = 0; j < histLength; j++) {				
-		testNode[j].index = j + 1;
-		testNode[j].value = histogram->getData()[j];
+	for(unsigned int j = 0; j < m_classNames.size(); j++) {
+		const double* weights = &m_weights[j * m_numWeights];
+		double value = weights[histLength];
+		for(unsigned int k = 0; k < histLength; k++) {
+			value += weights[k] * data[k];
+		}
+		values[j] = value;
+	}
+
+	// Logistic regression gives the same probabilities as LIBLINEAR, with
+	// the binary probabilities normalized across the classes. The SVMs give
+	// their decision values instead. Classes missing from the training data
+	// can never be predicted.
+	vector<pair<unsigned int, double> > ranking;
+	double total = 0.0;
+	for(unsigned int j = 0; j < m_classNames.size(); j++) {
+		double value = values[j];
+		if(!m_trained[j]) {
+			value = isLogistic() ? 0.0 : -HUGE_VAL;
+		} else if(isLogistic()) {
+			value = 1.0 / (1.0 + exp(-value));
+		}
+		total += value;
+		ranking.push_back(make_pair(j, value));
+	}
+
+	if(isLogistic() && total > 0.0) {
+		for(unsigned int j = 0; j < ranking.size(); j++) {
+			ranking[j].second /= total;
+		}
 	}
-	testNode[histLength].index = histLength + 1;
-	testNode[histLength].value = 1.0;
-	testNode[histLength + 1].index = -1;
-	
-	vector<double> probabilities(m_classNames.size(), 0.0);
-	unsigned int predictedClass =
-		linear::predict_probability(m_svmModel, testNode, &probabilities[0]);
 	
-	return make_pair(predictedClass,
-		*max_element(probabilities.begin(), probabilities.end()));
+	stable_sort(ranking.begin(), ranking.end(),
+		[](const pair<unsigned int, double>& a,
+			const pair<unsigned int, double>& b) {
+			return a.second > b.second;
+		});
+	return ranking;
 }
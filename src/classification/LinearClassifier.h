@@ -5,6 +5,9 @@
 #include <string>
 #include <cstring>
 #include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <cmath>
 
 namespace linear {
 	#include <linear.h>
@@ -14,12 +17,40 @@ namespace linear {
 #include "classification/Classifier.h"
 #include "classification/ConfusionMatrix.h"
 #include "codebook/Histogram.h"
+#include "utils/ProgressTracker.h"
+#include "utils/CounterRandom.h"
 
 /**
  * @brief Trains a linear SVM for image classification.
  *
  * Trains several Support Vector Machine classifiers using a one-vs-all
  * technique to distinguish between several image classes.
+ *
+ * Each class is trained as a separate binary LIBLINEAR problem. All of them
+ * read the same training data and are solved in parallel, up to the
+ * @a classifier.workers setting, where 0 uses every core. The solver is
+ * chosen with the @a classifier.solver setting:
+ *
+ * - @a LR: logistic regression, solved in the primal.
+ * - @a LRDual: logistic regression, solved with dual coordinate descent.
+ * - @a L2LossDual: L2-loss SVM, solved with dual coordinate descent.
+ * - @a L1LossDual: L1-loss SVM, solved with dual coordinate descent.
+ *
+ * The dual solvers are usually much faster on large histograms. They shuffle
+ * the images with rand(), whose state LIBLINEAR shares between every thread,
+ * so by default their classes are trained one at a time, each one from its
+ * own seed derived from @a framework.seed. The models then never depend on
+ * the order the classes are solved in. Setting @a classifier.parallelDual
+ * trains them in parallel like the other solvers, but the shuffles then
+ * depend on the timing of the threads and the models are not reproducible.
+ *
+ * LIBLINEAR only reads its own nodes of double precision values, so the rows
+ * of the training matrix are copied into them while training, taking 16
+ * bytes for each value. The copy is released once the models are trained.
+ *
+ * A trained classifier can be refined with new images through update(),
+ * which runs a few epochs of stochastic gradient descent (Pegasos) on the
+ * loss of the chosen solver, starting from the current weights.
  */
 class LinearClassifier : public Classifier {
 public:
@@ -34,22 +65,50 @@ public:
 	 */
 	LinearClassifier(const SettingsManager* settings,
 		std::vector<std::string> classNames);
-	~LinearClassifier();
 	
-	void train(std::vector<Histogram*> histograms,
+	using Classifier::train;
+	void train(std::shared_ptr<const TrainingMatrix> trainingData);
+
+	void update(std::vector<Histogram*> histograms,
 		std::vector<unsigned int> imageClasses);
 
 	std::pair<unsigned int, double> classify(Histogram* histogram);
+	
+	std::vector<std::pair<unsigned int, double> > rank(Histogram* histogram);
 
 private:
 	float m_c;
+	unsigned int m_numWorkers;
+	int m_solverType;
+	double m_eps;
+	unsigned int m_updateEpochs;
+	uint64_t m_seed;
+	bool m_parallelDual;
+	unsigned int m_numSamples;
 	std::vector<std::string> m_classNames;
 
-	linear::problem* m_svmProb;
-	linear::model* m_svmModel;
-	linear::parameter* m_svmParams;
-	
-	void clearData();
+	// The weights of each class, followed by its bias, one class after
+	// another. Classes without training images are not trained.
+	unsigned int m_numWeights;
+	std::vector<double> m_weights;
+	std::vector<bool> m_trained;
+
+	bool isDual() const {
+		return m_solverType != linear::L2R_LR;
+	}
+
+	bool isLogistic() const {
+		return m_solverType == linear::L2R_LR ||
+			m_solverType == linear::L2R_LR_DUAL;
+	}
+
+	void trainClass(unsigned int desiredClass, linear::feature_node** data,
+		unsigned int descriptorLength,
+		const std::vector<unsigned int>& imageClasses);
+	void updateClass(unsigned int desiredClass,
+		const std::vector<std::vector<float> >& rows,
+		const std::vector<unsigned int>& imageClasses);
+	double lossGradient(double margin) const;
 };
 
 #endif
@@ -3,82 +3,108 @@ using namespace std;
 
 SVMClassifier::SVMClassifier(const SettingsManager* settings,
 		vector<string> classNames) {
-		
+
 	svm_set_print_string_function(&printSvm);
-	
+
 	m_c = settings->get<float>("classifier.c");
+	m_numWorkers = settings->get<unsigned int>("classifier.workers", 0);
 	m_classNames = classNames;
 	m_svmParams = nullptr;
-	m_svmProbs.resize(m_classNames.size(), nullptr);
-	m_svmModels.resize(m_classNames.size(), nullptr);
 }
 
 SVMClassifier::~SVMClassifier() {
-	if(m_svmProbs[0] != nullptr) {
-		for(unsigned int i = 0; i < m_trainHistograms.size(); i++) {
-			delete[] m_svmProbs[0]->x[i];
-		}
-		delete[] m_svmProbs[0]->x;
-	}
-	
-	for(unsigned int i = 0; i < m_classNames.size(); i++) {
+	clearData();
+}
+
+void SVMClassifier::clearData() {
+	for(unsigned int i = 0; i < m_svmModels.size(); i++) {
 		if(m_svmModels[i] != nullptr) {
-			delete m_svmModels[i];
-		}
-		
-		if(m_svmProbs[i] != nullptr) {
-			delete[] m_svmProbs[i]->y;
-			delete m_svmProbs[i];
+			svm_free_and_destroy_model(&m_svmModels[i]);
 		}
 	}
+	m_svmModels.clear();
+	m_sampleNodes.clear();
+	m_supportVectors.clear();
+	m_trainingData.reset();
 
 	if(m_svmParams != nullptr) {
+		delete[] m_svmParams->weight_label;
+		delete[] m_svmParams->weight;
 		delete m_svmParams;
+		m_svmParams = nullptr;
 	}
 }
 
-float* SVMClassifier::flattenHistogramData() {
-	int histLength = m_trainHistograms[0]->getLength();
-	int datasetSize = m_trainHistograms.size() * histLength;
-	float* data = new float[datasetSize];
-	int currentIndex = 0;
-	for(unsigned int i = 0; i < m_trainHistograms.size(); i++) {
-		memcpy(&data[currentIndex], m_trainHistograms[i]->getData(), histLength);
-		currentIndex += histLength;
+vector<svm_node> SVMClassifier::buildKernelRows(
+		const TrainingMatrix& trainingData) {
+	
+	// libsvm reads a precomputed kernel as one row of nodes per image, whose
+	// first node holds the position of the image and the last one ends the row
+	unsigned int size = trainingData.getNumRows();
+	unsigned int length = trainingData.getNumColumns();
+	size_t stride = (size_t) size + 2;
+	vector<svm_node> rows(size * stride);
+
+	// The kernel is symmetric, so each value is calculated once and written
+	// to both of its positions. Only the thread of row i writes the values
+	// of the pairs (i, j <= i), and the rows get longer towards the end.
+	ProgressTracker progress("Calculating kernel matrix", size);
+	#pragma omp parallel for schedule(dynamic, 16)
+	for(unsigned int i = 0; i < size; i++) {
+		svm_node* row = &rows[i * stride];
+		row[0].index = 0;
+		row[0].value = i + 1;
+		row[size + 1].index = -1;
+		for(unsigned int j = 0; j <= i; j++) {
+			double value = intersection(trainingData.getRow(i),
+				trainingData.getRow(j), length);
+			row[j + 1].index = j + 1;
+			row[j + 1].value = value;
+			rows[j * stride + i + 1].index = i + 1;
+			rows[j * stride + i + 1].value = value;
+		}
+		progress.increment();
 	}
-	return data;
+	return rows;
 }
 
-inline double SVMClassifier::intersectionKernel(Histogram* a, Histogram* b) {
-	double kernelVal = 0;	
-	for(unsigned int i = 0; i < a->getLength(); i++) {
-		kernelVal += min(a->getData()[i], b->getData()[i]);
+void SVMClassifier::trainClass(unsigned int desiredClass,
+		svm_node** kernelRows, const vector<unsigned int>& imageClasses) {
+
+	vector<double> classes(imageClasses.size());
+	for(unsigned int i = 0; i < imageClasses.size(); i++) {
+		classes[i] = imageClasses[i] == desiredClass;
 	}
-	return kernelVal;
-}
 
-double* SVMClassifier::buildClassList(unsigned int desiredClass) {
-	double* classes = new double[m_trainHistograms.size()];
-	for(unsigned int i = 0; i < m_trainHistograms.size(); i++) {
-		classes[i] = (unsigned int)m_trainClasses[i] == desiredClass;
+	svm_problem svmProb;
+	svmProb.l = imageClasses.size();
+	svmProb.y = &classes[0];
+	svmProb.x = kernelRows;
+	svm_model* model = svm_train(&svmProb, m_svmParams);
+
+	// The support vectors point to the kernel rows, which are released once
+	// every class is trained. Predicting only needs their positions.
+	for(int i = 0; i < model->l; i++) {
+		model->SV[i] = &m_sampleNodes[(int) model->SV[i][0].value - 1];
 	}
-	return classes;
+	m_svmModels[desiredClass] = model;
 }
 
-void SVMClassifier::train(vector<Histogram*> histograms,
-		vector<unsigned int> imageClasses) {
-		
-	m_trainHistograms = histograms;
-	for_each(imageClasses.begin(), imageClasses.end(), [&](double imgClass) {
-		m_trainClasses.push_back(imgClass);
-	});
-	
+void SVMClassifier::train(shared_ptr<const TrainingMatrix> trainingData) {
+	clearData();
+	m_trainingData = trainingData;
+	unsigned int numImages = trainingData->getNumRows();
+	const vector<unsigned int>& imageClasses = trainingData->getClasses();
+
 	OutputHelper::printMessage("Training Classifier:");
 
+	// Each worker keeps its own libsvm cache, so the memory is split
+	unsigned int numWorkers =
+		getNumWorkers(m_numWorkers, m_classNames.size());
 	m_svmParams = new svm_parameter();
 	m_svmParams->svm_type = C_SVC;
 	m_svmParams->kernel_type = PRECOMPUTED;
-	m_svmParams->cache_size = 1000;
+	m_svmParams->cache_size = 1000.0 / numWorkers;
 	m_svmParams->C = m_c;
 	m_svmParams->eps = 1e-6;
 	m_svmParams->shrinking = 1;
@@ -86,56 +112,76 @@ void SVMClassifier::train(vector<Histogram*> histograms,
 	m_svmParams->nr_weight = 2;
 	m_svmParams->weight_label = new int[2] {0, 1};
 	m_svmParams->weight = new double[2]
-		{100.0 / (histograms.size() - 100.0), 1.0};
+		{100.0 / (numImages - 100.0), 1.0};
 
-	svm_node** kernel = new svm_node*[m_trainHistograms.size()];
-	
-	unsigned int currentIter = 0;
-	#pragma omp parallel for
-	for(unsigned int i = 0; i < m_trainHistograms.size(); i++) {
-		kernel[i] = new svm_node[m_trainHistograms.size() + 2];
-		kernel[i][0].index = 0;
-		kernel[i][0].value = i + 1;
-		for(unsigned int j = 0; j < m_trainHistograms.size(); j++) {				
-			kernel[i][j+1].index = j + 1;
-			kernel[i][j+1].value =
-				intersectionKernel(m_trainHistograms[i], m_trainHistograms[j]);
+	m_sampleNodes.resize(numImages);
+	for(unsigned int i = 0; i < numImages; i++) {
+		m_sampleNodes[i].index = 0;
+		m_sampleNodes[i].value = i + 1;
+	}
+
+	vector<svm_node> kernelNodes = buildKernelRows(*trainingData);
+	vector<svm_node*> kernelRows(numImages);
+	for(unsigned int i = 0; i < numImages; i++) {
+		kernelRows[i] = &kernelNodes[(size_t) i * (numImages + 2)];
+	}
+
+	// The kernel is only read, so every class is trained at the same time
+	// from the same rows
+	m_svmModels.resize(m_classNames.size(), nullptr);
+	exception_ptr error;
+	{
+		ProgressTracker progress("Generating models", m_classNames.size());
+		#pragma omp parallel for schedule(dynamic) num_threads(numWorkers)
+		for(unsigned int i = 0; i < m_classNames.size(); i++) {
+			try {
+				trainClass(i, &kernelRows[0], imageClasses);
+			} catch(...) {
+				#pragma omp critical
+				if(!error) {
+					error = current_exception();
+				}
+			}
+			progress.increment();
 		}
-		
-		#pragma omp critical
-		{
-			currentIter++;
-			OutputHelper::printProgress("Calculating kernel matrix",
-				currentIter, m_trainHistograms.size());
+	}
+
+	if(error) {
+		rethrow_exception(error);
+	}
+
+	vector<bool> isSupportVector(numImages, false);
+	for(unsigned int i = 0; i < m_svmModels.size(); i++) {
+		for(int j = 0; j < m_svmModels[i]->l; j++) {
+			isSupportVector[(int) m_svmModels[i]->SV[j][0].value - 1] = true;
 		}
 	}
-	
-	for(unsigned int i = 0; i < m_classNames.size(); i++) {
-		m_svmProbs[i] = new svm_problem();
-		m_svmProbs[i]->l = m_trainHistograms.size();
-		m_svmProbs[i]->y = buildClassList(i);
-		m_svmProbs[i]->x = kernel;
-	
-		m_svmModels[i] = svm_train(m_svmProbs[i], m_svmParams);
-		//svm_save_model("model.out", m_svmModel);
-		cout << endl;
+	for(unsigned int i = 0; i < numImages; i++) {
+		if(isSupportVector[i]) {
+			m_supportVectors.push_back(i);
+		}
 	}
 }
 
 pair<unsigned int, double> SVMClassifier::classify(Histogram* histogram) {
-	svm_node testNode[m_trainHistograms.size() + 1];
+	return rank(histogram).front();
+}
+
+vector<pair<unsigned int, double> > SVMClassifier::rank(Histogram* histogram) {
+	// The models only read the kernel of their support vectors
+	vector<float> values = TrainingMatrix::toRow(histogram);
+	svm_node testNode[m_trainingData->getNumRows() + 1];
 	testNode[0].index = 0;
 	testNode[0].value = 0;
 	#pragma omp parallel for
-	for(unsigned int j = 0; j < m_trainHistograms.size(); j++) {				
-		testNode[j+1].index = j + 1;
-		testNode[j+1].value =
-			intersectionKernel(histogram, m_trainHistograms[j]);
+	for(unsigned int j = 0; j < m_supportVectors.size(); j++) {
+		unsigned int sample = m_supportVectors[j];
+		testNode[sample + 1].index = sample + 1;
+		testNode[sample + 1].value = intersection(
+			&values[0], m_trainingData->getRow(sample), values.size());
 	}
-	
-	unsigned int predictedClass = 0;
-	double predictedValue = 1e6;
-	
+
+	vector<pair<unsigned int, double> > ranking;
 	for(unsigned int j = 0; j < m_classNames.size(); j++) {
 		double thisValue;
 		double thisClass =
@@ -143,12 +189,15 @@ pair<unsigned int, double> SVMClassifier::classify(Histogram* histogram) {
 		thisValue = ((thisClass == 0 && thisValue < 0) ||
 			(thisClass == 1 && thisValue > 0)) ?
 			-thisValue : thisValue;
-					
-		if(thisValue < predictedValue) {
-			predictedValue = thisValue;
-			predictedClass = j;
-		}			
+		ranking.push_back(make_pair(j, thisValue));
 	}
-	
-	return make_pair(predictedClass, predictedValue);
+
+	// The lowest decision value is the most probable class, ties keep the
+	// order of the classes
+	stable_sort(ranking.begin(), ranking.end(),
+		[](const pair<unsigned int, double>& a,
+			const pair<unsigned int, double>& b) {
+			return a.second < b.second;
+		});
+	return ranking;
 }
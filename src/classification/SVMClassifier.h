@@ -5,19 +5,33 @@
 #include <string>
 #include <cstring>
 #include <algorithm>
+#include <exception>
 
 #include <libsvm/svm.h>
 
 #include "classification/Classifier.h"
 #include "framework/SettingsManager.h"
 #include "classification/ConfusionMatrix.h"
+#include "classification/TrainingMatrix.h"
 #include "codebook/Histogram.h"
+#include "utils/ProgressTracker.h"
 
 /**
  * @brief Trains a kernelized SVM for image classification.
  *
  * Trains several Support Vector Machine classifiers using a one-vs-all
  * technique to distinguish between several image classes.
+ *
+ * The intersection kernel of the training images is calculated once and
+ * shared by all the binary classifiers, which are trained in parallel. The
+ * number of classifiers trained at the same time is set by the
+ * @a classifier.workers setting, where 0 uses every core.
+ *
+ * libsvm reads a precomputed kernel as full rows of nodes, so while training
+ * the kernel takes 16 bytes for each pair of training images. The kernel is
+ * symmetric, so each value is only calculated once. The rows are released
+ * once the models are trained, the models only keep the position of their
+ * support vectors.
  */
 class SVMClassifier : public Classifier {
 public:
@@ -34,24 +48,44 @@ public:
 		std::vector<std::string> classNames);
 	~SVMClassifier();
 
-	void train(std::vector<Histogram*> histograms,
-		std::vector<unsigned int> imageClasses);
+	using Classifier::train;
+	void train(std::shared_ptr<const TrainingMatrix> trainingData);
 		
 	std::pair<unsigned int, double> classify(Histogram* histogram);
+	
+	std::vector<std::pair<unsigned int, double> > rank(Histogram* histogram);
 
 private:
 	float m_c;
-	std::vector<Histogram*> m_trainHistograms;
-	std::vector<double> m_trainClasses;
+	unsigned int m_numWorkers;
+	// The kernel of new images is calculated against the training images
+	std::shared_ptr<const TrainingMatrix> m_trainingData;
 	std::vector<std::string> m_classNames;
 
-	std::vector<svm_problem*> m_svmProbs;
 	std::vector<svm_model*> m_svmModels;
 	svm_parameter* m_svmParams;
+
+	// The support vectors of the models point to these nodes, which only
+	// contain the position of each training image in the kernel
+	std::vector<svm_node> m_sampleNodes;
+	// Training images used as a support vector by at least one model
+	std::vector<unsigned int> m_supportVectors;
+
+	void clearData();
+	std::vector<svm_node> buildKernelRows(const TrainingMatrix& trainingData);
+	void trainClass(unsigned int desiredClass, svm_node** kernelRows,
+		const std::vector<unsigned int>& imageClasses);
+	
+	// The sum of the minimum of each bin of both histograms
+	static double intersection(const float* a, const float* b,
+			unsigned int length) {
 		
-	float* flattenHistogramData();
-	double intersectionKernel(Histogram* a, Histogram* b);
-	double* buildClassList(unsigned int desiredClass);
+		double kernelVal = 0;
+		for(unsigned int i = 0; i < length; i++) {
+			kernelVal += std::min(a[i], b[i]);
+		}
+		return kernelVal;
+	}
 };
 
 #endif
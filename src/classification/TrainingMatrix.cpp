@@ -0,0 +1,152 @@
+#include "TrainingMatrix.h"
+using namespace std;
+
+static const char MATRIX_MAGIC[4] = {'D', 'N', 'M', '1'};
+
+// Followed by the classes, then by the rows, both starting on a 64 byte
+// boundary
+struct MatrixHeader {
+	char magic[4];
+	uint32_t numRows;
+	uint32_t numColumns;
+	uint32_t stride;
+	uint64_t fingerprint;
+	uint8_t reserved[40];
+};
+
+TrainingMatrix::TrainingMatrix(const vector<Histogram*>& histograms,
+		const vector<unsigned int>& imageClasses) {
+
+	m_numRows = histograms.size();
+	m_numColumns = histograms.empty() ? 0 : histograms[0]->getLength();
+	m_stride = (m_numColumns + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	m_classes = imageClasses;
+
+	// Extra room to move the start of the rows to a 64 byte boundary
+	m_memory.assign((size_t) m_numRows * m_stride + ALIGNMENT, 0.0f);
+	uintptr_t address = (uintptr_t) m_memory.data();
+	size_t misalignment = address % (ALIGNMENT * sizeof(float));
+	float* data = m_memory.data() + (misalignment == 0 ?
+		0 : (ALIGNMENT * sizeof(float) - misalignment) / sizeof(float));
+	m_data = data;
+
+	#pragma omp parallel for
+	for(unsigned int i = 0; i < m_numRows; i++) {
+		const double* histogram = histograms[i]->getData();
+		float* row = data + (size_t) i * m_stride;
+		for(unsigned int j = 0; j < m_numColumns; j++) {
+			row[j] = histogram[j];
+		}
+	}
+}
+
+vector<float> TrainingMatrix::toRow(const Histogram* histogram) {
+	return vector<float>(histogram->getData(),
+		histogram->getData() + histogram->getLength());
+}
+
+TrainingMatrix* TrainingMatrix::load(string filename, uint64_t fingerprint) {
+	boost::system::error_code error;
+	uintmax_t fileSize = boost::filesystem::file_size(filename, error);
+	if(error || fileSize < sizeof(MatrixHeader)) {
+		return nullptr;
+	}
+
+	TrainingMatrix* matrix = new TrainingMatrix();
+	try {
+		boost::interprocess::file_mapping file(filename.c_str(),
+			boost::interprocess::read_only);
+		boost::interprocess::mapped_region region(file,
+			boost::interprocess::read_only);
+		matrix->m_region.swap(region);
+	} catch(boost::interprocess::interprocess_exception&) {
+		delete matrix;
+		return nullptr;
+	}
+
+	const char* address = (const char*) matrix->m_region.get_address();
+	MatrixHeader header;
+	memcpy(&header, address, sizeof(header));
+	size_t dataOffset = getDataOffset(header.numRows);
+	if(memcmp(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC)) != 0 ||
+			header.fingerprint != fingerprint ||
+			header.stride < header.numColumns ||
+			fileSize != dataOffset +
+				(uintmax_t) header.numRows * header.stride * sizeof(float)) {
+
+		delete matrix;
+		return nullptr;
+	}
+
+	matrix->m_numRows = header.numRows;
+	matrix->m_numColumns = header.numColumns;
+	matrix->m_stride = header.stride;
+	const uint32_t* classes =
+		(const uint32_t*) (address + sizeof(MatrixHeader));
+	matrix->m_classes.assign(classes, classes + header.numRows);
+	matrix->m_data = (const float*) (address + dataOffset);
+	return matrix;
+}
+
+void TrainingMatrix::save(string filename, uint64_t fingerprint) const {
+	boost::filesystem::path filePath(filename);
+	boost::filesystem::create_directories(filePath.parent_path());
+
+	MatrixHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+	header.numRows = m_numRows;
+	header.numColumns = m_numColumns;
+	header.stride = m_stride;
+	header.fingerprint = fingerprint;
+
+	vector<uint32_t> classes(m_classes.begin(), m_classes.end());
+	size_t dataOffset = getDataOffset(m_numRows);
+	vector<char> padding(dataOffset - sizeof(header) -
+		classes.size() * sizeof(uint32_t), 0);
+
+	// As with the cache entries, a unique temporary file is renamed over the
+	// final one
+	string tempFilename = filename + "." +
+		boost::filesystem::unique_path().string() + ".tmp";
+	bool written;
+	{
+		std::ofstream ofs(tempFilename, ios::binary);
+		ofs.write((const char*) &header, sizeof(header));
+		ofs.write((const char*) classes.data(),
+			classes.size() * sizeof(uint32_t));
+		ofs.write(padding.data(), padding.size());
+		ofs.write((const char*) m_data,
+			(size_t) m_numRows * m_stride * sizeof(float));
+		ofs.close();
+		written = !ofs.fail();
+	}
+
+	boost::system::error_code error;
+	if(written) {
+		boost::filesystem::rename(tempFilename, filename, error);
+	}
+	if(!written || error) {
+		boost::filesystem::remove(tempFilename, error);
+	}
+}
+
+uint64_t TrainingMatrix::getFingerprint(const vector<string>& imagePaths,
+		const vector<unsigned int>& imageClasses) {
+
+	// FNV-1a over every path followed by its class
+	uint64_t hash = 14695981039346656037ull;
+	for(unsigned int i = 0; i < imagePaths.size(); i++) {
+		string key = imagePaths[i] + '\0' + to_string(imageClasses[i]) + '\0';
+		for(unsigned int j = 0; j < key.size(); j++) {
+			hash = (hash ^ (unsigned char) key[j]) * 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+size_t TrainingMatrix::getDataOffset(unsigned int numRows) {
+	size_t size = sizeof(MatrixHeader) + (size_t) numRows * sizeof(uint32_t);
+	size_t alignment = ALIGNMENT * sizeof(float);
+	return (size + alignment - 1) / alignment * alignment;
+}
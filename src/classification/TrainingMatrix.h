@@ -0,0 +1,147 @@
+#ifndef TRAINING_MATRIX_H
+#define TRAINING_MATRIX_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "codebook/Histogram.h"
+
+/**
+ * @brief Stores the histograms and classes of the training images.
+ *
+ * The histograms are kept as a single matrix of floats, one row per image,
+ * which is the input of the classifiers. New images must be rounded the same
+ * way with toRow() before they are classified. Each row starts on a 64 byte
+ * boundary, so it can be read with vector instructions.
+ *
+ * The matrix can be saved to a file with the same layout and mapped back
+ * into memory, so training from the cache does not deserialize every
+ * histogram. The pages of the file are only read when they are first used.
+ *
+ * The matrix does not replace the input of the solvers: libsvm and LIBLINEAR
+ * only read their own nodes, which the classifiers build from the matrix while
+ * training. See SVMClassifier and LinearClassifier for the memory they take.
+ *
+ * The file also holds a fingerprint of the training images, so a matrix
+ * saved for another set of images is never used.
+ */
+class TrainingMatrix {
+public:
+	/**
+	 * @brief Copies a set of histograms into a matrix.
+	 *
+	 * @param histograms The histograms of the images, which must all have the
+	 * same length. They can be deleted afterwards.
+	 * @param imageClasses The class of each image.
+	 */
+	TrainingMatrix(const std::vector<Histogram*>& histograms,
+		const std::vector<unsigned int>& imageClasses);
+
+	/**
+	 * @brief Maps a matrix saved with save().
+	 *
+	 * @param filename The file holding the matrix.
+	 * @param fingerprint The fingerprint of the expected training images.
+	 * @return The matrix, or @a nullptr if the file does not exist, is not
+	 * valid or was saved for other images.
+	 */
+	static TrainingMatrix* load(std::string filename, uint64_t fingerprint);
+
+	/**
+	 * @brief Writes the matrix to a file.
+	 *
+	 * The file is replaced at once, so it is never left partially written.
+	 *
+	 * @param filename The file to be written.
+	 * @param fingerprint The fingerprint of the training images.
+	 */
+	void save(std::string filename, uint64_t fingerprint) const;
+
+	/**
+	 * @brief Rounds a histogram to the precision of the rows.
+	 *
+	 * The classifiers compare new images with the values they were trained
+	 * on, so a training image gets the same kernel or decision value when it
+	 * is classified.
+	 *
+	 * @param histogram The histogram of an image.
+	 * @return The values of the histogram, as stored in a row.
+	 */
+	static std::vector<float> toRow(const Histogram* histogram);
+
+	/**
+	 * @brief Identifies a set of training images.
+	 *
+	 * @param imagePaths The paths of the images.
+	 * @param imageClasses The class of each image.
+	 * @return A hash of the paths and classes, in order.
+	 */
+	static uint64_t getFingerprint(const std::vector<std::string>& imagePaths,
+		const std::vector<unsigned int>& imageClasses);
+
+	/**
+	 * @brief Provides the number of images.
+	 *
+	 * @return The number of rows of the matrix.
+	 */
+	unsigned int getNumRows() const {
+		return m_numRows;
+	}
+
+	/**
+	 * @brief Provides the length of the histograms.
+	 *
+	 * @return The number of values in each row.
+	 */
+	unsigned int getNumColumns() const {
+		return m_numColumns;
+	}
+
+	/**
+	 * @brief Provides the histogram of an image.
+	 *
+	 * @param row The index of the image.
+	 * @return The values of the histogram.
+	 */
+	const float* getRow(unsigned int row) const {
+		return m_data + (size_t) row * m_stride;
+	}
+
+	/**
+	 * @brief Provides the classes of the images.
+	 *
+	 * @return The class of each row.
+	 */
+	const std::vector<unsigned int>& getClasses() const {
+		return m_classes;
+	}
+
+private:
+	// The number of floats filling 64 bytes
+	static const unsigned int ALIGNMENT = 16;
+
+	unsigned int m_numRows;
+	unsigned int m_numColumns;
+	unsigned int m_stride;
+	std::vector<unsigned int> m_classes;
+
+	// The values point either to the memory of this instance or to the
+	// mapped file
+	const float* m_data;
+	std::vector<float> m_memory;
+	boost::interprocess::mapped_region m_region;
+
+	TrainingMatrix() {};
+	TrainingMatrix(const TrainingMatrix&) = delete;
+	TrainingMatrix& operator=(const TrainingMatrix&) = delete;
+	static size_t getDataOffset(unsigned int numRows);
+};
+
+#endif
@@ -1,6 +1,11 @@
 #ifndef CODEBOOK_H
 #define CODEBOOK_H
 
+#include <stdexcept>
+#include <cstdint>
+
+#include <boost/serialization/version.hpp>
+
 #include "features/ImageFeatures.h"
 #include "codebook/Histogram.h"
 
@@ -13,7 +18,35 @@
  */
 class Codebook {
 public:
+	Codebook() : m_seed(0) {}
 	virtual ~Codebook() {}
+	
+	/**
+	 * @brief Provides the seed used to generate the codebook.
+	 *
+	 * @return The value of @a framework.seed when the codebook was generated.
+	 * Codebooks cached before the seed was recorded return 0.
+	 */
+	uint64_t getSeed() const {
+		return m_seed;
+	}
+	
+	/**
+	 * @brief Records the seed used to generate the codebook.
+	 *
+	 * @param seed The seed given to the codebook generator.
+	 */
+	void setSeed(uint64_t seed) {
+		m_seed = seed;
+	}
+	
+	/**
+	 * @brief Builds all the state required to encode features.
+	 *
+	 * Must be called once, after the codebook is generated or loaded from the
+	 * cache, and before any call to encode(). Calling it again has no effect.
+	 */
+	virtual void prepare() = 0;
 
 	/**
 	 * @brief Computes the histogram of one image.
@@ -22,16 +55,29 @@ public:
 	 * reduce the ammount of data and then encodes those new features into a
 	 * spatial histogram.
 	 *
+	 * This function does not change the codebook and can be safely called
+	 * from multiple threads at the same time.
+	 *
+	 * @pre The codebook must be prepared using prepare()
+	 *
 	 * @param imageFeatures The features of one image which will be encoded
 	 * using the codebook and then grouped into an histogram.
 	 * @return The histogram which encodes the given image features.
 	 */
-	virtual Histogram* encode(ImageFeatures* imageFeatures) = 0;
+	virtual Histogram* encode(const ImageFeatures* imageFeatures) const = 0;
 
 private:
+	uint64_t m_seed;
+	
 	friend class boost::serialization::access;
 	template<class Archive>
-	void serialize(Archive & ar, const unsigned int version) {}
+	void serialize(Archive & ar, const unsigned int version) {
+		if(version >= 1) {
+			ar & m_seed;
+		}
+	}
 };
 
+BOOST_CLASS_VERSION(Codebook, 1)
+
 #endif
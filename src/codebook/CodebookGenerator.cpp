@@ -3,28 +3,86 @@ using namespace std;
 
 CodebookGenerator::CodebookGenerator(const SettingsManager* settings) {
 	m_numFeatures = settings->get<unsigned int>("codebook.totalFeatures");
+	m_seed = settings->get<uint64_t>("framework.seed", 0);
 }
 
 vector<float> CodebookGenerator::generateDescriptorSet(
 		vector<ImageFeatures*> imageFeatures) const {
 		
-	int descriptorSize = imageFeatures[0]->getDescriptorSize();
-	vector<float> descriptors;
+	unsigned int descriptorSize = imageFeatures[0]->getDescriptorSize();
 	
-	unsigned int numDescriptors = 0;
+	// Position of the first descriptor of each image among all descriptors
+	vector<uint64_t> offsets(imageFeatures.size() + 1, 0);
 	for(unsigned int i = 0; i < imageFeatures.size(); i++) {
-		numDescriptors += imageFeatures[i]->getNumFeatures();
+		offsets[i + 1] = offsets[i] + imageFeatures[i]->getNumFeatures();
 	}
+	uint64_t numDescriptors = offsets.back();
+	uint64_t numSamples = min<uint64_t>(m_numFeatures, numDescriptors);
 	
-	double odds = m_numFeatures / (double)numDescriptors;
-	for(unsigned int i = 0; i < imageFeatures.size(); i++) {
-		for(unsigned int j = 0; j < imageFeatures[i]->getNumFeatures(); j++) {
-			if(((double)rand()/(double)RAND_MAX) < odds) {
-				const float* feature = imageFeatures[i]->getFeature(j);
-				copy(feature, feature + descriptorSize,
-					back_inserter(descriptors));
+	// Every descriptor gets a random key and the ones with the smallest keys
+	// are kept. The keys only depend on the seed and the position of each
+	// descriptor, so the sample does not depend on the number of threads.
+	// Only the keys below a threshold, chosen to let a few more than needed
+	// through, are collected; it is raised in the unlikely case of too few.
+	CounterRandom random(m_seed, CounterRandom::DESCRIPTOR_SAMPLING);
+	double expected = numSamples + 4.0 * sqrt((double) numSamples) + 16.0;
+	double fraction = expected / max<uint64_t>(numDescriptors, 1);
+	vector<pair<uint64_t, uint64_t> > candidates;
+	while(true) {
+		uint64_t threshold = fraction >= 1.0 ?
+			UINT64_MAX : (uint64_t) (fraction * 18446744073709551616.0);
+		
+		vector<vector<pair<uint64_t, uint64_t> > > imageCandidates(
+			imageFeatures.size());
+		#pragma omp parallel for schedule(dynamic)
+		for(unsigned int i = 0; i < imageFeatures.size(); i++) {
+			for(uint64_t j = offsets[i]; j < offsets[i + 1]; j++) {
+				uint64_t key = random(j);
+				if(key <= threshold) {
+					imageCandidates[i].push_back(make_pair(key, j));
+				}
 			}
 		}
+		
+		candidates.clear();
+		for(unsigned int i = 0; i < imageCandidates.size(); i++) {
+			candidates.insert(candidates.end(),
+				imageCandidates[i].begin(), imageCandidates[i].end());
+		}
+		
+		if(candidates.size() >= numSamples || fraction >= 1.0)
+			break;
+		fraction *= 2.0;
+	}
+	
+	nth_element(candidates.begin(), candidates.begin() + numSamples,
+		candidates.end());
+	candidates.resize(numSamples);
+	
+	// Keep the samples in the order of the descriptors, so each image is
+	// read by a single thread
+	vector<uint64_t> samples(numSamples);
+	for(unsigned int i = 0; i < numSamples; i++) {
+		samples[i] = candidates[i].second;
+	}
+	vector<pair<uint64_t, uint64_t> >().swap(candidates);
+	sort(samples.begin(), samples.end());
+	
+	vector<float> descriptors(numSamples * descriptorSize);
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int i = 0; i < imageFeatures.size(); i++) {
+		vector<uint64_t>::const_iterator first = lower_bound(
+			samples.begin(), samples.end(), offsets[i]);
+		vector<uint64_t>::const_iterator last = lower_bound(
+			first, samples.cend(), offsets[i + 1]);
+		
+		vector<float> buffer(descriptorSize);
+		for(vector<uint64_t>::const_iterator it = first; it != last; it++) {
+			const float* feature =
+				imageFeatures[i]->getFeature(*it - offsets[i], buffer.data());
+			copy(feature, feature + descriptorSize, descriptors.begin() +
+				(it - samples.cbegin()) * descriptorSize);
+		}
 	}
 	
 	return descriptors;
@@ -2,8 +2,12 @@
 #define CODEBOOK_GENERATOR_H
 
 #include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
 
 #include "framework/SettingsManager.h"
+#include "utils/CounterRandom.h"
 #include "features/ImageFeatures.h"
 #include "codebook/Codebook.h"
 
@@ -37,7 +41,18 @@ public:
 
 protected:
 	unsigned int m_numFeatures;
+	uint64_t m_seed;
 	
+	/**
+	 * @brief Samples the descriptors used to generate a codebook.
+	 *
+	 * Exactly @a codebook.totalFeatures descriptors, or all of them if there
+	 * are fewer, are chosen uniformly without replacement. The choice only
+	 * depends on @a framework.seed and the given features.
+	 *
+	 * @param imageFeatures The features of several images.
+	 * @return The chosen descriptors, one after the other.
+	 */
 	std::vector<float> generateDescriptorSet(
 		std::vector<ImageFeatures*> imageFeatures) const;
 };
@@ -1,14 +1,18 @@
 #include "FisherCodebook.h"
 using namespace std;
 
+// The number of compacted features dequantized at a time
+static const unsigned int DEQUANTIZED_BLOCK = 256;
+
 FisherCodebook::FisherCodebook() {
 	m_codebook = nullptr;
 }
 
 FisherCodebook::FisherCodebook(gaussian_mixture<float>* gmm,
-		pca_online_t* pca, unsigned int pcaDim) {
+		pca_online_t* pca, unsigned int pcaDim, bool whitening) {
 	
 	m_pcaDim = pcaDim;
+	m_whitening = whitening;
 	m_gmm = gmm;
 	m_codebook = nullptr;
 	m_pca = pca;
@@ -23,8 +27,7 @@ FisherCodebook::~FisherCodebook() {
 	}
 }
 
-Histogram* FisherCodebook::encode(ImageFeatures* imageFeatures) {
-	#pragma omp critical
+void FisherCodebook::prepare() {
 	if(m_codebook == nullptr) {
 		fisher_param params;
 		params.grad_weights = true;
@@ -33,15 +36,30 @@ Histogram* FisherCodebook::encode(ImageFeatures* imageFeatures) {
 		m_codebook = new fisher<float>(params);
 		m_codebook->set_model(*m_gmm);
 	}
+}
+
+Histogram* FisherCodebook::encode(const ImageFeatures* imageFeatures) const {
+	if(m_codebook == nullptr)
+		throw std::logic_error("codebook was not prepared");
 	
 	unsigned int numFeatures = imageFeatures->getNumFeatures();
 	
 	if(!numFeatures)
 		throw std::length_error("feature vector is empty");
 
+	unsigned int descriptorSize = imageFeatures->getDescriptorSize();
 	vector<float> pcaFeatures(numFeatures * m_pcaDim, 0.0);
-	pca_online_project(m_pca, imageFeatures->getFeatures(), &pcaFeatures[0],
-		imageFeatures->getDescriptorSize(), numFeatures, m_pcaDim);
+	vector<float> buffer(min(numFeatures, DEQUANTIZED_BLOCK) * descriptorSize);
+	for(unsigned int first = 0; first < numFeatures;
+			first += DEQUANTIZED_BLOCK) {
+		unsigned int count = min(numFeatures - first, DEQUANTIZED_BLOCK);
+		pca_online_project(m_pca,
+			imageFeatures->getFeatures(first, count, buffer.data()),
+			&pcaFeatures[first * m_pcaDim], descriptorSize, count, m_pcaDim);
+	}
+	if(m_whitening) {
+		whiten(m_pca, &pcaFeatures[0], numFeatures, m_pcaDim);
+	}
 
 	vector<float*> samples(numFeatures, nullptr);
 	for(unsigned int i = 0; i < numFeatures; i++) {
@@ -62,3 +80,20 @@ Histogram* FisherCodebook::encode(ImageFeatures* imageFeatures) {
 	vector<double> histogram(result, result + fisherLength);	
 	return new Histogram(&histogram[0], fisherLength);
 }
+
+void FisherCodebook::whiten(const pca_online_t* pca, float* features,
+		unsigned int numFeatures, unsigned int pcaDim) {
+	
+	vector<float> scales(pcaDim);
+	float epsilon = 1e-5f * max(pca->eigval[0], 0.0f) + 1e-10f;
+	for(unsigned int j = 0; j < pcaDim; j++) {
+		scales[j] = 1.0f / sqrt(max(pca->eigval[j], 0.0f) + epsilon);
+	}
+	
+	for(unsigned int i = 0; i < numFeatures; i++) {
+		float* feature = &features[i * pcaDim];
+		for(unsigned int j = 0; j < pcaDim; j++) {
+			feature[j] *= scales[j];
+		}
+	}
+}
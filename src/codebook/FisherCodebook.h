@@ -9,6 +9,8 @@ extern "C" {
 }
 
 #include <vector>
+#include <cmath>
+#include <algorithm>
 
 #include <gmm.h>
 #include <fisher.h>
@@ -16,6 +18,7 @@ extern "C" {
 #include <boost/serialization/export.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/split_member.hpp>
+#include <boost/serialization/version.hpp>
 
 #include "codebook/Codebook.h"
 #include "features/ImageFeatures.h"
@@ -26,7 +29,8 @@ extern "C" {
  *
  * The dimensionality of each feature is reduced using Principal Component
  * Analysis and is then encoded using soft-assignment to clusters and using the
- * distance, mean and variance as statistics.
+ * distance, mean and variance as statistics. The projected features can
+ * optionally be whitened, giving every principal component unit variance.
  */
 class FisherCodebook : public Codebook {
 public:
@@ -38,15 +42,33 @@ public:
 	 * @param gmm The Gaussian Mixture Model to be used to encode the features.
 	 * @param pca Principal Component Analysis matrix used to reduce
 	 * feature dimensionality.
+	 * @param pcaDim The number of principal components kept.
+	 * @param whitening Whether the projected features are whitened.
 	 */
 	FisherCodebook(gaussian_mixture<float>* gmm,
-		pca_online_t* pca, unsigned int pcaDim);
+		pca_online_t* pca, unsigned int pcaDim, bool whitening);
 	~FisherCodebook();
 	
-	Histogram* encode(ImageFeatures* imageFeatures);
+	void prepare();
+	Histogram* encode(const ImageFeatures* imageFeatures) const;
+	
+	/**
+	 * @brief Whitens a set of features projected with a PCA matrix.
+	 *
+	 * Each component is divided by its standard deviation, with a small
+	 * regularization relative to the largest eigenvalue.
+	 *
+	 * @param pca The PCA used to project the features.
+	 * @param features The projected features, modified in place.
+	 * @param numFeatures The number of features.
+	 * @param pcaDim The dimension of each projected feature.
+	 */
+	static void whiten(const pca_online_t* pca, float* features,
+		unsigned int numFeatures, unsigned int pcaDim);
 	
 private:
 	unsigned int m_pcaDim;
+	bool m_whitening;
 	fisher<float>* m_codebook;
 	gaussian_mixture<float>* m_gmm;
 	pca_online_t* m_pca;
@@ -60,8 +82,23 @@ private:
 	{
 		ar & boost::serialization::base_object<Codebook>(*this);
 		
-		m_gmm->save("fishercodebook");
+		int numClusters = m_gmm->n_gauss();
+		int gmmDim = m_gmm->n_dim();
+		ar << numClusters;
+		ar << gmmDim;
+		for(int k = 0; k < numClusters; k++) {
+			float coefficient = m_gmm->get_mixing_coefficients(k);
+			ar << coefficient;
+			for(int i = 0; i < gmmDim; i++) {
+				ar << m_gmm->get_mean(k)[i];
+			}
+			for(int i = 0; i < gmmDim; i++) {
+				ar << m_gmm->get_variance(k)[i];
+			}
+		}
 		
+		ar << m_pcaDim;
+		ar << m_whitening;
 		ar << m_pca->d;
 		for(int i = 0; i < m_pca->d; i++) {
 			ar << m_pca->mu[i];
@@ -69,23 +106,79 @@ private:
 		for(int i = 0; i < m_pca->d * m_pca->d; i++) {
 			ar << m_pca->eigvec[i];
 		}
+		for(int i = 0; i < m_pca->d; i++) {
+			ar << m_pca->eigval[i];
+		}
+	}
+	template<class Archive>
+	void loadModel(Archive& ar)
+	{
+		int numClusters, gmmDim;
+		ar >> numClusters;
+		ar >> gmmDim;
+		
+		std::vector<float> coefficients(numClusters);
+		std::vector<std::vector<float>> means(numClusters,
+			std::vector<float>(gmmDim));
+		std::vector<std::vector<float>> variances(numClusters,
+			std::vector<float>(gmmDim));
+		for(int k = 0; k < numClusters; k++) {
+			ar >> coefficients[k];
+			for(int i = 0; i < gmmDim; i++) {
+				ar >> means[k][i];
+			}
+			for(int i = 0; i < gmmDim; i++) {
+				ar >> variances[k][i];
+			}
+		}
+		
+		std::vector<float*> meanPointers, variancePointers;
+		for(int k = 0; k < numClusters; k++) {
+			meanPointers.push_back(&means[k][0]);
+			variancePointers.push_back(&variances[k][0]);
+		}
+		m_gmm = new gaussian_mixture<float>(numClusters, gmmDim);
+		m_gmm->set(meanPointers, variancePointers, coefficients);
 	}
 	template<class Archive>
 	void load(Archive& ar, const unsigned int version)
 	{
 		ar & boost::serialization::base_object<Codebook>(*this);
 		
-		m_gmm = new gaussian_mixture<float>("fishercodebook");
-
-		ar >> m_pcaDim;
-		m_pca = pca_online_new(m_pcaDim);
+		// Before the second version the GMM was written to a fixed file next
+		// to the cache, shared by every codebook
+		if(version >= 2) {
+			loadModel(ar);
+		} else {
+			m_gmm = new gaussian_mixture<float>("fishercodebook");
+		}
+		
+		// The first version only stored the full descriptor dimension, the
+		// number of principal components has to be taken from the GMM
+		m_pcaDim = m_gmm->n_dim();
+		m_whitening = false;
+		if(version >= 1) {
+			ar >> m_pcaDim;
+			ar >> m_whitening;
+		}
+		
+		int descriptorSize;
+		ar >> descriptorSize;
+		m_pca = pca_online_new(descriptorSize);
 		for(int i = 0; i < m_pca->d; i++) {
 			ar >> m_pca->mu[i];
 		}
 		for(int i = 0; i < m_pca->d * m_pca->d; i++) {
 			ar >> m_pca->eigvec[i];
 		}
+		if(version >= 1) {
+			for(int i = 0; i < m_pca->d; i++) {
+				ar >> m_pca->eigval[i];
+			}
+		}
 	}
 };
 
+BOOST_CLASS_VERSION(FisherCodebook, 2)
+
 #endif
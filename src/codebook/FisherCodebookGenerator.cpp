@@ -6,6 +6,7 @@ FisherCodebookGenerator::FisherCodebookGenerator(
 	
 	m_numClusters = settings->get<unsigned int>("codebook.codewords");
 	m_pcaDim = settings->get<unsigned int>("codebook.pcaDimension");
+	m_pcaWhitening = settings->get<bool>("codebook.pcaWhitening", false);
 }
 
 Codebook* FisherCodebookGenerator::generate(
@@ -23,6 +24,9 @@ Codebook* FisherCodebookGenerator::generate(
 	vector<float> pcaFeatures(numFeatures * m_pcaDim, 0.0);
 	pca_online_project(pca, &descriptors[0], &pcaFeatures[0],
 		descriptorSize, numFeatures, m_pcaDim);
+	if(m_pcaWhitening) {
+		FisherCodebook::whiten(pca, &pcaFeatures[0], numFeatures, m_pcaDim);
+	}
 	descriptors.clear();
 
 	// Spend some precious CPU cycles converting data into
@@ -35,11 +39,13 @@ Codebook* FisherCodebookGenerator::generate(
 		}
 	}
 	
-	// Use k-means to initialize GMM
+	// Use k-means to initialize GMM. Yael picks a random seed when given 0.
+	CounterRandom random(m_seed, CounterRandom::CLUSTERING);
+	long kmeansSeed = (random(0) >> 33) + 1;
 	float* distances = new float[numFeatures];
 	float* centroids = new float[numFeatures * m_pcaDim];
 	kmeans(m_pcaDim, numFeatures, m_numClusters, 1000, &pcaFeatures[0],
-		4, -1, 1, centroids, distances, nullptr, nullptr);
+		4, kmeansSeed, 1, centroids, distances, nullptr, nullptr);
 	
 	vector<float*> mean(m_numClusters, nullptr);
 	for(unsigned int i = 0; i < m_numClusters; i++) {
@@ -79,5 +85,8 @@ Codebook* FisherCodebookGenerator::generate(
 		delete[] samples[i];
 	}
 	
-	return new FisherCodebook(gmm, pca, m_pcaDim);
+	Codebook* codebook =
+		new FisherCodebook(gmm, pca, m_pcaDim, m_pcaWhitening);
+	codebook->setSeed(m_seed);
+	return codebook;
 }
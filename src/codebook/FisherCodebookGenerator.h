@@ -42,6 +42,7 @@ public:
 	
 private:
 	unsigned int m_pcaDim;
+	bool m_pcaWhitening;
 	unsigned int m_numClusters;
 };
 
@@ -1,6 +1,9 @@
 #include "KMeansCodebook.h"
 using namespace std;
 
+// The number of compacted features dequantized at a time
+static const unsigned int DEQUANTIZED_BLOCK = 256;
+
 KMeansCodebook::KMeansCodebook() {
 	m_kmeans = nullptr;
 	m_numClusters = 0;
@@ -39,14 +42,18 @@ unsigned int KMeansCodebook::histogramIndex(unsigned int level,
 	return levelIndex + cellIndex + index;
 }
 
-Histogram* KMeansCodebook::encode(ImageFeatures* imageFeatures) {
-	
+void KMeansCodebook::prepare() {
 	if(m_kmeans == nullptr) {
 		m_kmeans = vl_kmeans_new(VL_TYPE_FLOAT, VlDistanceL2);
 		vl_kmeans_set_algorithm(m_kmeans, VlKMeansElkan);
 		vl_kmeans_set_centers(m_kmeans, &m_centers[0],
 			m_centers.size() / m_numClusters, m_numClusters);
 	}
+}
+
+Histogram* KMeansCodebook::encode(const ImageFeatures* imageFeatures) const {
+	if(m_kmeans == nullptr)
+		throw std::logic_error("codebook was not prepared");
 	
 	unsigned int totalLength = (m_type == SQUARES) ?
 		m_numClusters * (pow(4, m_levels + 1) - 1) / 3 :
@@ -57,8 +64,14 @@ Histogram* KMeansCodebook::encode(ImageFeatures* imageFeatures) {
 	int numFeatures = imageFeatures->getNumFeatures();
 	
 	vl_uint32* assignments = new vl_uint32[numFeatures];
-	vl_kmeans_quantize(m_kmeans, assignments, nullptr,
-		imageFeatures->getFeatures(), numFeatures);
+	vector<float> buffer(min<unsigned int>(numFeatures, DEQUANTIZED_BLOCK) *
+		imageFeatures->getDescriptorSize());
+	for(int first = 0; first < numFeatures; first += DEQUANTIZED_BLOCK) {
+		unsigned int count =
+			min<unsigned int>(numFeatures - first, DEQUANTIZED_BLOCK);
+		vl_kmeans_quantize(m_kmeans, assignments + first, nullptr,
+			imageFeatures->getFeatures(first, count, buffer.data()), count);
+	}
 			
 	for(int i = 0; i < numFeatures; i++) {
 		pair<int, int> position = imageFeatures->getCoordinates(i);
@@ -48,7 +48,8 @@ public:
 		unsigned int dataSize, Type type, unsigned int levels);
 	~KMeansCodebook();
 
-	Histogram* encode(ImageFeatures* imageFeatures);
+	void prepare();
+	Histogram* encode(const ImageFeatures* imageFeatures) const;
 	
 private:
 	Type m_type;
@@ -24,9 +24,16 @@ Codebook* KMeansCodebookGenerator::generate(
 	vl_kmeans_set_algorithm(kmeans, VlKMeansElkan);
 	vl_kmeans_set_num_repetitions(kmeans, 1);
 	vl_kmeans_set_max_num_iterations(kmeans, 500);
+	
+	// The k-means++ initialization uses the generator of the current thread
+	CounterRandom random(m_seed, CounterRandom::CLUSTERING);
+	vl_rand_seed(vl_get_rand(), random(0));
 	vl_kmeans_cluster(kmeans, &descriptors[0],
 		descriptorSize, descriptors.size() / descriptorSize, m_numClusters);
 	
-	return new KMeansCodebook((const float*)vl_kmeans_get_centers(kmeans),
+	Codebook* codebook = new KMeansCodebook(
+		(const float*)vl_kmeans_get_centers(kmeans),
 		m_numClusters, descriptorSize, m_type, m_levels);
+	codebook->setSeed(m_seed);
+	return codebook;
 }
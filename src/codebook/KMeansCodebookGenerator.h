@@ -3,6 +3,7 @@
 
 extern "C" {
 	#include <vl/kmeans.h>
+	#include <vl/random.h>
 }
 
 #include <vector>
@@ -0,0 +1,18 @@
+#include "FeatureExtractor.h"
+using namespace std;
+
+FeatureExtractor::FeatureExtractor(const SettingsManager* settings) {
+	string layout = settings->get<string>("features.layout", "Interleaved");
+	if(layout == "Interleaved") {
+		m_layout = ImageFeatures::INTERLEAVED;
+	} else if(layout == "Blocked") {
+		m_layout = ImageFeatures::BLOCKED;
+	} else {
+		throw runtime_error("unknown feature layout " + layout);
+	}
+}
+
+ImageFeatures* FeatureExtractor::createFeatures(const ImageData* img) const {
+	return new ImageFeatures(img->getWidth(), img->getHeight(),
+		img->getNumChannels(), m_layout);
+}
@@ -8,9 +8,12 @@ extern "C" {
 }
 
 #include <bitset>
+#include <string>
+#include <stdexcept>
 
 #include "images/ImageData.h"
 #include "features/ImageFeatures.h"
+#include "framework/SettingsManager.h"
 
 /**
  * @brief Extracts the features of an image.
@@ -22,7 +25,15 @@ extern "C" {
  */
 class FeatureExtractor {
 public:
+	/**
+	 * @brief Loads the settings shared by all the feature extractors.
+	 *
+	 * @param settings Manager that allows any required settings
+	 * to be loaded from the configuration file.
+	 */
+	FeatureExtractor(const SettingsManager* settings);
 	virtual ~FeatureExtractor() {};
+	
 	/**
 	 * @brief Extract the features of one image.
 	 *
@@ -33,6 +44,18 @@ public:
 	 * @return All the features extracted for this image.
 	 */
 	virtual ImageFeatures* extract(const ImageData* img) const = 0;
+	
+protected:
+	ImageFeatures::Layout m_layout;
+	
+	/**
+	 * @brief Creates an empty set of features for an image, using the
+	 * descriptor layout defined in the settings.
+	 *
+	 * @param img The image the features will be extracted from.
+	 * @return An empty set of features.
+	 */
+	ImageFeatures* createFeatures(const ImageData* img) const;
 };
 
 #endif
@@ -6,25 +6,25 @@
 /**
  * @brief Transforms the features of an image.
  *
- * These transformations are applied on a set of previously extracted features
- * and can be chained together. The transformed features are not guaranteed to
- * be of the same dimension as the input data.
+ * These transformations are applied in place on each previously extracted
+ * descriptor and can be chained together. The whole chain is applied to one
+ * descriptor before moving to the next, so the features are only traversed
+ * once regardless of the number of transformations.
  */
 class FeatureTransform {
 public:
 	virtual ~FeatureTransform() {};
 
 	/**
-	 * @brief Transform the features of one image.
+	 * @brief Transforms one descriptor in place.
 	 *
-	 * @warning The original image features will be deleted. Use the returned
-	 * pointer instead.
-	 *
-	 * @param orig The original features to be processed.
-	 * @return The result of applying the transformation to the
-	 * original features.
+	 * @param descriptor The descriptor to be processed. It is overwritten
+	 * with the result of the transformation.
+	 * @param descriptorSize The length of the descriptor, including all the
+	 * image channels.
 	 */
-	virtual ImageFeatures* transform(const ImageFeatures* orig) const = 0;
+	virtual void transform(float* descriptor,
+		unsigned int descriptorSize) const = 0;
 };
 
 #endif
@@ -1,87 +1,74 @@
 #include "HOGFeatureExtractor.h"
 using namespace std;
 
-HOGFeatureExtractor::HOGFeatureExtractor(const SettingsManager* settings) {
+HOGFeatureExtractor::HOGFeatureExtractor(const SettingsManager* settings) :
+		FeatureExtractor(settings) {
+	
 	m_gridSpacing = settings->get<vector<int> >("features.gridSpacing")[0];
 	m_patchSize = settings->get<vector<int> >("features.patchSize")[0];
 }
 
-float* HOGFeatureExtractor::stackFeatures(float* descriptors,
-		unsigned int descriptorSize, unsigned int numDescriptors,
-		unsigned int width, unsigned int height, unsigned int numStacks) const {
-	
-	unsigned int stride = descriptorSize * numStacks * numStacks;
-	float* newDescriptors = new float[
-		(width - numStacks + 1) * (height - numStacks + 1) * stride];
+void HOGFeatureExtractor::stackFeatures(const float* cells,
+		unsigned int cellSize, unsigned int numCellsX, unsigned int numCellsY,
+		float* blocks, unsigned int stride, unsigned int blockStride) const {
 	
-	float* newDescPtr = newDescriptors;
-	float* descPtr = descriptors;
-	for(unsigned int y = 0; y < (height - numStacks + 1); y++) {
-		for(unsigned int x = 0; x < (width - numStacks + 1); x++) {	
-			for(unsigned int dx = 0; dx < numStacks; dx++) {
-				for(unsigned int dy = 0; dy < numStacks; dy++) {
-					unsigned int offset =  ((x + dx) * descriptorSize) +
-						((y + dy) * descriptorSize * width);
-					copy(descPtr + offset,
-						descPtr + offset + descriptorSize, newDescPtr);
-					newDescPtr += descriptorSize;
+	// The cell histograms are stored one dimension at a time, so each value
+	// of a block is read from its plane and written with the channel stride
+	unsigned int planeSize = numCellsX * numCellsY;
+	for(unsigned int y = 0; y < numCellsY - NUM_STACKS + 1; y++) {
+		for(unsigned int x = 0; x < numCellsX - NUM_STACKS + 1; x++) {
+			float* value = blocks;
+			blocks += blockStride;
+			for(unsigned int dx = 0; dx < NUM_STACKS; dx++) {
+				for(unsigned int dy = 0; dy < NUM_STACKS; dy++) {
+					const float* cell = &cells[(y + dy) * numCellsX + x + dx];
+					for(unsigned int k = 0; k < cellSize; k++) {
+						*value = cell[k * planeSize];
+						value += stride;
+					}
 				}
 			}
 		}
 	}
-	return newDescriptors;
 }
 
 ImageFeatures* HOGFeatureExtractor::extract(const ImageData* img) const {
-	ImageFeatures* imageFeatures = new ImageFeatures(
-		img->getWidth(), img->getHeight(), img->getNumChannels());
-			
-	unsigned int numStacks = 2;
-	
-	vector<pair<int, int> > coordinates;
-	for(unsigned int x = m_gridSpacing / 2; x < img->getWidth();
-			x += m_gridSpacing) {
-			
-		for(unsigned int y = m_gridSpacing / 2; y < img->getHeight();
-				y += m_gridSpacing) {
-				
-			coordinates.push_back(make_pair(x, y));
-		}
-	}
+	ImageFeatures* imageFeatures = createFeatures(img);
 	
+	VlHog* hog = vl_hog_new(VlHogVariantUoctti, 9, false);
+	vector<float> cells;
 	for(unsigned int i = 0; i < img->getNumChannels(); i++) {
-		VlHog* hog = vl_hog_new(VlHogVariantUoctti, 9, false);
 		vl_hog_put_image(hog, img->getData(i), img->getWidth(),
 			img->getHeight(), 1, m_gridSpacing);
 		
-		int descriptorSize = vl_hog_get_dimension(hog);
-		int numDescriptors = vl_hog_get_width(hog) * vl_hog_get_height(hog);
-
-		float* descriptors =
-			new float[descriptorSize * numDescriptors];
-		vl_hog_extract(hog, descriptors);
+		unsigned int cellSize = vl_hog_get_dimension(hog);
+		unsigned int numCellsX = vl_hog_get_width(hog);
+		unsigned int numCellsY = vl_hog_get_height(hog);
+		if(numCellsX < NUM_STACKS || numCellsY < NUM_STACKS)
+			break;
 		
-		unsigned int numDescX = (img->getWidth() + m_gridSpacing / 2)
-			/ m_gridSpacing;
-		unsigned int numDescY = (img->getHeight() + m_gridSpacing / 2)
-			/ m_gridSpacing;
-		float* newDescriptors = stackFeatures(descriptors, descriptorSize,
-			numDescriptors,	numDescX, numDescY, numStacks);
-	
+		// The blocks are centered on the corner shared by their cells
 		if(i == 0) {
-			imageFeatures->newFeatures(newDescriptors,
-				descriptorSize * numStacks,
-				(numDescX - numStacks + 1) * (numDescY - numStacks + 1),
-				coordinates);
-		} else {
-			imageFeatures->extendFeatures(i, newDescriptors,
-				(numDescX - numStacks + 1) * (numDescY - numStacks + 1));
+			vector<pair<int, int> > coordinates;
+			for(unsigned int y = 1; y < numCellsY; y++) {
+				for(unsigned int x = 1; x < numCellsX; x++) {
+					coordinates.push_back(
+						make_pair(x * m_gridSpacing, y * m_gridSpacing));
+				}
+			}
+			imageFeatures->allocateFeatures(
+				cellSize * NUM_STACKS * NUM_STACKS,
+				coordinates.size(), coordinates);
 		}
-	
-		delete[] descriptors;
-		delete[] newDescriptors;
-		vl_hog_delete(hog);
+		
+		cells.resize(cellSize * numCellsX * numCellsY);
+		vl_hog_extract(hog, cells.data());
+		stackFeatures(cells.data(), cellSize, numCellsX, numCellsY,
+			imageFeatures->getChannelFeatures(i),
+			imageFeatures->getChannelStride(),
+			imageFeatures->getDescriptorSize());
 	}
+	vl_hog_delete(hog);
 	
 	return imageFeatures;
 }
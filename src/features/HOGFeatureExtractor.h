@@ -13,6 +13,9 @@ extern "C" {
  *
  * HOGs are extracted on a regular grid and their main advantage is the
  * low computational cost required to extract them.
+ *
+ * Each descriptor is a block of 2x2 neighbouring cells, which is written
+ * directly into the image features from the cell histograms.
  */
 class HOGFeatureExtractor : public FeatureExtractor {
 public:
@@ -30,9 +33,11 @@ private:
 	unsigned int m_gridSpacing;
 	unsigned int m_patchSize;
 	
-	float* stackFeatures(float* descriptors,
-		unsigned int descriptorSize, unsigned int numDescriptors,
-		unsigned int width, unsigned int height, unsigned int numStacks) const;
+	static const unsigned int NUM_STACKS = 2;
+	
+	void stackFeatures(const float* cells, unsigned int cellSize,
+		unsigned int numCellsX, unsigned int numCellsY,
+		float* blocks, unsigned int stride, unsigned int blockStride) const;
 };
 
 #endif
@@ -1,6 +1,8 @@
 #ifndef HELLINGER_FEATURE_TRANSFORM_H
 #define HELLINGER_FEATURE_TRANSFORM_H
 
+#include <cmath>
+
 #include "framework/SettingsManager.h"
 #include "features/FeatureTransform.h"
 #include "features/ImageFeatures.h"
@@ -11,6 +13,9 @@
  * By applying this tranformation to a set of features, calculating the
  * Euclidean distance between any feature pair will result, approximately,
  * in the same value as the one of the Hellinger kernel for that pair.
+ *
+ * Each descriptor is L1 normalized and then square rooted, which also leaves
+ * it L2 normalized, as in RootSIFT.
  */
 class HellingerFeatureTransform : public FeatureTransform {
 public:
@@ -21,7 +26,7 @@ public:
 	 * to be loaded from the configuration file.
 	 */
 	HellingerFeatureTransform(const SettingsManager* settings);
-	ImageFeatures* transform(const ImageFeatures* orig) const;
+	void transform(float* descriptor, unsigned int descriptorSize) const;
 };
 
 #endif
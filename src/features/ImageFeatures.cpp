@@ -2,6 +2,9 @@
 using namespace std;
 
 ImageFeatures::ImageFeatures() {
+	m_layout = INTERLEAVED;
+	m_storage = FLOAT32;
+	m_baseIndex = 0;
 	m_numChannels = 0;
 	m_descriptorSize = 0;
 	m_numFeatures = 0;
@@ -10,8 +13,14 @@ ImageFeatures::ImageFeatures() {
 };
 
 ImageFeatures::ImageFeatures(unsigned int width, unsigned int height,
-		unsigned int numChannels) {
-		
+		unsigned int numChannels, Layout layout) {
+	
+	if(width > UINT16_MAX || height > UINT16_MAX)
+		throw length_error("image is too large for 16 bit coordinates");
+	
+	m_layout = layout;
+	m_storage = FLOAT32;
+	m_baseIndex = 0;
 	m_numChannels = numChannels;
 	m_descriptorSize = 0;
 	m_numFeatures = 0;
@@ -19,13 +28,30 @@ ImageFeatures::ImageFeatures(unsigned int width, unsigned int height,
 	m_height = height;
 }
 
+void ImageFeatures::reserve(unsigned int numFeatures,
+		unsigned int descriptorSize) {
+	
+	m_features.reserve(m_features.size() +
+		numFeatures * descriptorSize * m_numChannels);
+	m_coordinates.reserve(m_coordinates.size() + numFeatures);
+}
+
 void ImageFeatures::extendFeatures(unsigned int channel, float const* features,
 		unsigned int numFeatures) {
 	
-	for(unsigned int i = 0;
-			i < (m_descriptorSize / m_numChannels) * numFeatures; i++) {
-			
-		m_features[m_baseIndex + (i * m_numChannels) + channel] = features[i];
+	unsigned int channelSize = m_descriptorSize / m_numChannels;
+	if(m_layout == BLOCKED) {
+		float* dst = getChannelFeatures(channel);
+		for(unsigned int i = 0; i < numFeatures; i++) {
+			copy(features, features + channelSize, dst);
+			features += channelSize;
+			dst += m_descriptorSize;
+		}
+	} else {
+		for(unsigned int i = 0; i < channelSize * numFeatures; i++) {
+			m_features[m_baseIndex + (i * m_numChannels) + channel] =
+				features[i];
+		}
 	}
 }
 
@@ -33,6 +59,16 @@ void ImageFeatures::newFeatures(float const* features,
 		unsigned int descriptorSize, unsigned int numFeatures,
 		vector<pair<int, int> > coordinates) {
 	
+	allocateFeatures(descriptorSize, numFeatures, coordinates);
+	extendFeatures(0, features, numFeatures);
+}
+
+void ImageFeatures::allocateFeatures(unsigned int descriptorSize,
+		unsigned int numFeatures, const vector<pair<int, int> >& coordinates) {
+	
+	if(m_storage != FLOAT32)
+		throw logic_error("compacted features are read only");
+	
 	m_descriptorSize = m_numChannels * descriptorSize;
 	m_numFeatures += numFeatures;
 	
@@ -41,7 +77,121 @@ void ImageFeatures::newFeatures(float const* features,
 	
 	m_baseIndex = m_features.size();
 	m_features.resize(m_descriptorSize * m_numFeatures);
-	for(unsigned int i = 0; i < descriptorSize * numFeatures; i++) {
-		m_features[m_baseIndex + (i * m_numChannels)] = features[i];
+}
+
+const float* ImageFeatures::getFeatures(unsigned int first,
+		unsigned int count, float* buffer) const {
+	
+	if(m_storage == FLOAT32)
+		return &m_features[first * m_descriptorSize];
+	
+	for(unsigned int i = 0; i < count; i++) {
+		dequantize(first + i, &buffer[i * m_descriptorSize]);
 	}
+	return buffer;
+}
+
+void ImageFeatures::compact(Storage storage) {
+	if(storage == m_storage)
+		return;
+	if(m_storage != FLOAT32)
+		throw logic_error("features were already compacted");
+	
+	if(storage == FLOAT16) {
+		m_halfFeatures.resize(m_features.size());
+		for(unsigned int i = 0; i < m_features.size(); i++) {
+			m_halfFeatures[i] = floatToHalf(m_features[i]);
+		}
+	} else if(storage == UINT8) {
+		m_byteFeatures.resize(m_features.size());
+		m_byteRanges.resize(m_numFeatures * 2);
+		for(unsigned int i = 0; i < m_numFeatures; i++) {
+			const float* feature = &m_features[i * m_descriptorSize];
+			pair<const float*, const float*> range =
+				minmax_element(feature, feature + m_descriptorSize);
+			float offset = *range.first;
+			float scale = (*range.second - *range.first) / 255.0f;
+			
+			uint8_t* bytes = &m_byteFeatures[i * m_descriptorSize];
+			for(unsigned int j = 0; j < m_descriptorSize; j++) {
+				bytes[j] = scale > 0.0f ?
+					lround((feature[j] - offset) / scale) : 0;
+			}
+			m_byteRanges[i * 2] = offset;
+			m_byteRanges[i * 2 + 1] = scale;
+		}
+	}
+	
+	m_storage = storage;
+	vector<float>().swap(m_features);
+}
+
+void ImageFeatures::dequantize(unsigned int index, float* feature) const {
+	if(m_storage == FLOAT16) {
+		const uint16_t* halves = &m_halfFeatures[index * m_descriptorSize];
+		for(unsigned int j = 0; j < m_descriptorSize; j++) {
+			feature[j] = halfToFloat(halves[j]);
+		}
+	} else {
+		const uint8_t* bytes = &m_byteFeatures[index * m_descriptorSize];
+		float offset = m_byteRanges[index * 2];
+		float scale = m_byteRanges[index * 2 + 1];
+		for(unsigned int j = 0; j < m_descriptorSize; j++) {
+			feature[j] = offset + bytes[j] * scale;
+		}
+	}
+}
+
+uint16_t ImageFeatures::floatToHalf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	
+	uint16_t sign = (bits >> 16) & 0x8000;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	int exponent = ((bits >> 23) & 0xFF) - 127 + 15;
+	
+	if((bits & 0x7FFFFFFF) > 0x7F800000)
+		return sign | 0x7E00;
+	if(exponent >= 31)
+		return sign | 0x7C00;
+	
+	// Values below the normal range become subnormals or zero, rounding
+	// to the nearest even value in both cases
+	if(exponent <= 0) {
+		if(exponent < -10)
+			return sign;
+		mantissa |= 0x800000;
+		unsigned int shift = 14 - exponent;
+		uint16_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1 << shift) - 1);
+		uint32_t halfway = 1 << (shift - 1);
+		if(remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return sign | half;
+	}
+	
+	uint16_t half = sign | (exponent << 10) | (mantissa >> 13);
+	if((mantissa & 0x1000) && (mantissa & 0x2FFF))
+		half++;
+	return half;
+}
+
+float ImageFeatures::halfToFloat(uint16_t value) {
+	uint32_t sign = (value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+	
+	uint32_t bits;
+	if(exponent == 0) {
+		float subnormal = mantissa * 5.9604645e-8f;
+		return sign ? -subnormal : subnormal;
+	} else if(exponent == 31) {
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
 }
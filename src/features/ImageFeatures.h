@@ -2,17 +2,48 @@
 #define IMAGE_FEATURES_H
 
 #include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
 
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/version.hpp>
 
 /**
  * @brief Stores all the features of one image.
  *
  * When an image contains multiple channels, the descriptors for each channel
- * are merged, creating a longer descriptor for each point.
+ * are merged, creating a longer descriptor for each point. The order of the
+ * values inside that longer descriptor is defined by its Layout.
+ *
+ * Once all the features have been added and transformed, they can be
+ * compacted into a smaller Storage type, both in memory and in the cache.
+ * Compacted features are dequantized on the fly when they are fetched, into
+ * a buffer provided by the caller, so several threads can read the same
+ * features at once. Reading them a block at a time avoids expanding the
+ * whole set back to floats.
  */
 class ImageFeatures {
 public:
+	/**
+	 * @brief The way the channels are merged into a single descriptor.
+	 */
+	enum Layout {
+		INTERLEAVED, /**< the values of all the channels alternate */
+		BLOCKED      /**< each channel is a contiguous block of values */
+	};
+	
+	/**
+	 * @brief The type used to store the values of the descriptors.
+	 */
+	enum Storage {
+		FLOAT32, /**< full precision floats */
+		FLOAT16, /**< half precision floats */
+		UINT8    /**< bytes, scaled to the range of each descriptor */
+	};
+	
 	/**
 	 * @brief Defines some information reguarding the original image.
 	 *
@@ -22,9 +53,21 @@ public:
 	 * @param width The width of the original image.
 	 * @param height The height of the original image.
 	 * @param numChannels The number of channels of the original image.
+	 * @param layout The way the channels are merged into each descriptor.
 	 */
 	ImageFeatures(unsigned int width, unsigned int height,
-		unsigned int numChannels);
+		unsigned int numChannels, Layout layout = INTERLEAVED);
+	
+	/**
+	 * @brief Preallocates the storage for features that will be added later.
+	 *
+	 * This avoids reallocating the features when they are added by several
+	 * calls to newFeatures() or allocateFeatures().
+	 *
+	 * @param numFeatures The number of features that will be added.
+	 * @param descriptorSize The length of each descriptor, for one channel.
+	 */
+	void reserve(unsigned int numFeatures, unsigned int descriptorSize);
 	
 	/**
 	 * @brief Stores a new set of features for an image.
@@ -65,6 +108,48 @@ public:
 	 */
 	void extendFeatures(unsigned int channel, float const* features,
 		unsigned int numFeatures);
+	
+	/**
+	 * @brief Reserves the storage for a new set of features.
+	 *
+	 * This works like newFeatures(), but instead of copying the features
+	 * from an array, the storage is left for the caller to fill in, for all
+	 * the channels, through getChannelFeatures().
+	 *
+	 * @see newFeatures()
+	 *
+	 * @param descriptorSize The length of each descriptor, for one channel.
+	 * @param numFeatures The number of features to reserve.
+	 * @param coordinates The keypoint of each of the reserved features.
+	 */
+	void allocateFeatures(unsigned int descriptorSize,
+		unsigned int numFeatures,
+		const std::vector<std::pair<int, int> >& coordinates);
+	
+	/**
+	 * @brief Returns a strided view over one channel of the last set of
+	 * features created by newFeatures() or allocateFeatures().
+	 *
+	 * Consecutive values of that channel inside one descriptor are
+	 * getChannelStride() floats apart, while consecutive descriptors are
+	 * getDescriptorSize() floats apart.
+	 *
+	 * @param channel The image channel to access.
+	 * @return A pointer to the first value of the channel.
+	 */
+	float* getChannelFeatures(unsigned int channel) {
+		return m_features.data() + m_baseIndex + getChannelOffset(channel);
+	}
+	
+	/**
+	 * @brief Returns the distance between consecutive values of one channel
+	 * in the arrays returned by getChannelFeatures().
+	 *
+	 * @return The stride of each channel.
+	 */
+	unsigned int getChannelStride() const {
+		return m_layout == BLOCKED ? 1 : m_numChannels;
+	}
 
 	/**
 	 * @brief Returns the total number of stored features.
@@ -95,22 +180,45 @@ public:
 	 * The returned array is getDescriptorSize() long.
 	 *
 	 * @param index A zero based index for the requested feature.
+	 * @param buffer Room for getDescriptorSize() floats, where the feature is
+	 * dequantized if the features have been compacted.
+	 * @return A pointer to the requested feature, either stored or in
+	 * @a buffer.
+	 */
+	const float* getFeature(unsigned int index, float* buffer) const {
+		return getFeatures(index, 1, buffer);
+	}
+	
+	/**
+	 * @brief Fetches a single feature for modification.
+	 *
+	 * @warning Only available before the features are compacted.
+	 *
+	 * @see getFeature()
+	 *
+	 * @param index A zero based index for the requested feature.
 	 * @return A pointer to the requested feature.
 	 */
-	const float* getFeature(unsigned int index) const {
+	float* getMutableFeature(unsigned int index) {
+		if(m_storage != FLOAT32)
+			throw std::logic_error("compacted features are read only");
 		return &m_features[index * m_descriptorSize];
 	}
 	
 	/**
-	 * @brief Fetches all the features of the image.
+	 * @brief Fetches a block of consecutive features.
 	 *
-	 * The returned array is getNumFeatures() times getDescriptorSize() long.
-	 * 
-	 * @return An array containing the entire feature set.
+	 * The returned array is @a count times getDescriptorSize() long.
+	 *
+	 * @param first A zero based index for the first requested feature.
+	 * @param count The number of requested features.
+	 * @param buffer Room for @a count times getDescriptorSize() floats, where
+	 * the features are dequantized if they have been compacted.
+	 * @return An array containing the requested features, either stored or
+	 * in @a buffer.
 	 */
-	const float* getFeatures() const {
-		return &m_features[0];
-	}
+	const float* getFeatures(unsigned int first, unsigned int count,
+		float* buffer) const;
 	
 	/**
 	 * @brief Returns the coordinates of one feature.
@@ -121,7 +229,8 @@ public:
 	 * the @a Y coordinate in the second element.
 	 */
 	std::pair<int, int> getCoordinates(unsigned int index) const {
-		return m_coordinates[index];
+		return std::pair<int, int>(
+			m_coordinates[index].first, m_coordinates[index].second);
 	}
 	
 	/**
@@ -157,7 +266,38 @@ public:
 		return m_numChannels;
 	}
 	
+	/**
+	 * @brief Returns the way the channels are merged into each descriptor.
+	 *
+	 * @return The layout of the descriptors.
+	 */
+	Layout getLayout() const {
+		return m_layout;
+	}
+	
+	/**
+	 * @brief Converts the stored features into a smaller type.
+	 *
+	 * After this call no more features can be added or modified.
+	 *
+	 * @param storage The type to store the descriptors with.
+	 */
+	void compact(Storage storage);
+	
+	/**
+	 * @brief Returns the type used to store the descriptors.
+	 *
+	 * @return The storage of the descriptors.
+	 */
+	Storage getStorage() const {
+		return m_storage;
+	}
+	
 private:
+	typedef std::pair<uint16_t, uint16_t> Coordinate;
+	
+	Layout m_layout;
+	Storage m_storage;
 	unsigned int m_baseIndex;
 	unsigned int m_numChannels;
 	unsigned int m_descriptorSize;
@@ -165,22 +305,70 @@ private:
 	std::vector<float> m_features;
 	unsigned int m_width;
 	unsigned int m_height;
-	std::vector<std::pair<int, int> > m_coordinates;
+	std::vector<Coordinate> m_coordinates;
+	
+	// Compacted descriptors, with an offset and scale per descriptor
+	// when stored as bytes
+	std::vector<uint16_t> m_halfFeatures;
+	std::vector<uint8_t> m_byteFeatures;
+	std::vector<float> m_byteRanges;
+	
+	void dequantize(unsigned int index, float* feature) const;
+	static uint16_t floatToHalf(float value);
+	static float halfToFloat(uint16_t value);
 	
 	// Boost serialization
 	friend class boost::serialization::access;
 	ImageFeatures();
+	
+	unsigned int getChannelOffset(unsigned int channel) const {
+		return m_layout == BLOCKED ?
+			channel * (m_descriptorSize / m_numChannels) : channel;
+	}
+	
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version)
 	{
+		int layout = m_layout;
+		if(version >= 1) {
+			ar & layout;
+		}
+		m_layout = static_cast<Layout>(layout);
+		
+		int storage = m_storage;
+		if(version >= 2) {
+			ar & storage;
+		}
+		m_storage = static_cast<Storage>(storage);
+		
 		ar & m_numChannels;
 		ar & m_descriptorSize;
 		ar & m_numFeatures;
-		ar & m_features;
+		switch(m_storage) {
+			case FLOAT32:
+				ar & m_features;
+				break;
+			case FLOAT16:
+				ar & m_halfFeatures;
+				break;
+			case UINT8:
+				ar & m_byteFeatures;
+				ar & m_byteRanges;
+				break;
+		}
 		ar & m_width;
 		ar & m_height;
-		ar & m_coordinates;
+		
+		if(version >= 2) {
+			ar & m_coordinates;
+		} else {
+			std::vector<std::pair<int, int> > coordinates;
+			ar & coordinates;
+			m_coordinates.assign(coordinates.begin(), coordinates.end());
+		}
 	}
 };
 
+BOOST_CLASS_VERSION(ImageFeatures, 2)
+
 #endif
@@ -0,0 +1,22 @@
+#include "L2FeatureTransform.h"
+using namespace std;
+
+L2FeatureTransform::L2FeatureTransform(const SettingsManager* settings) {
+	
+}
+
+void L2FeatureTransform::transform(float* descriptor,
+		unsigned int descriptorSize) const {
+	
+	float l2norm = 1e-10f;
+	#pragma omp simd reduction(+:l2norm)
+	for(unsigned int j = 0; j < descriptorSize; j++) {
+		l2norm += descriptor[j] * descriptor[j];
+	}
+	
+	float scale = 1.0f / sqrt(l2norm);
+	#pragma omp simd
+	for(unsigned int j = 0; j < descriptorSize; j++) {
+		descriptor[j] *= scale;
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef L2_FEATURE_TRANSFORM_H
+#define L2_FEATURE_TRANSFORM_H
+
+#include <cmath>
+
+#include "framework/SettingsManager.h"
+#include "features/FeatureTransform.h"
+#include "features/ImageFeatures.h"
+
+/**
+ * @brief Normalizes each descriptor to unit Euclidean length.
+ *
+ * This is usually placed at the end of the transformation chain, after
+ * transformations that change the norm of the descriptors, such as the power
+ * normalization.
+ */
+class L2FeatureTransform : public FeatureTransform {
+public:
+	/**
+	 * @brief Initializes an instance of the L2 normalization.
+	 *
+	 * @param settings Manager that allows any required settings
+	 * to be loaded from the configuration file.
+	 */
+	L2FeatureTransform(const SettingsManager* settings);
+	void transform(float* descriptor, unsigned int descriptorSize) const;
+};
+
+#endif
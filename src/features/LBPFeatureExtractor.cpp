@@ -1,14 +1,15 @@
 #include "LBPFeatureExtractor.h"
 using namespace std;
 
-LBPFeatureExtractor::LBPFeatureExtractor(const SettingsManager* settings) {
+LBPFeatureExtractor::LBPFeatureExtractor(const SettingsManager* settings) :
+		FeatureExtractor(settings) {
+	
 	m_gridSpacing = settings->get<vector<int> >("features.gridSpacing")[0];
 	m_patchSize = settings->get<vector<int> >("features.patchSize")[0];
 }
 
 ImageFeatures* LBPFeatureExtractor::extract(const ImageData* img) const {
-	ImageFeatures* imageFeatures = new ImageFeatures(
-		img->getWidth(), img->getHeight(), img->getNumChannels());
+	ImageFeatures* imageFeatures = createFeatures(img);
 
 	// Compute census transform
 	vector<pair<int, int> > coordinates;
@@ -0,0 +1,170 @@
+#include "LBPHistogramFeatureExtractor.h"
+using namespace std;
+
+LBPHistogramFeatureExtractor::LBPHistogramFeatureExtractor(
+		const SettingsManager* settings) : FeatureExtractor(settings) {
+
+	m_gridSpacing = settings->get<vector<int> >("features.gridSpacing")[0];
+	m_patchSize = settings->get<vector<int> >("features.patchSize")[0];
+	string mapping = settings->get<string>("features.lbpMapping", "Uniform");
+
+	// Build the lookup table from the packed codes to the histogram bins
+	if(mapping == "Uniform") {
+		m_numBins = 59;
+		unsigned int bin = 0;
+		for(unsigned int code = 0; code < 256; code++) {
+			m_mapping[code] = countTransitions(code) <= 2 ? bin++ : 58;
+		}
+	} else if(mapping == "Rotation") {
+		m_numBins = 10;
+		for(unsigned int code = 0; code < 256; code++) {
+			m_mapping[code] =
+				countTransitions(code) <= 2 ? countBits(code) : 9;
+		}
+	} else {
+		throw runtime_error("unknown LBP mapping " + mapping);
+	}
+}
+
+ImageFeatures* LBPHistogramFeatureExtractor::extract(
+		const ImageData* img) const {
+
+	unsigned int width = img->getWidth();
+	unsigned int height = img->getHeight();
+	ImageFeatures* imageFeatures = createFeatures(img);
+
+	// The codes are only defined for pixels with all 8 neighbours
+	unsigned int codesWidth = width > 2 ? width - 2 : 0;
+	unsigned int codesHeight = height > 2 ? height - 2 : 0;
+	unsigned int numDescX = codesWidth >= m_patchSize ?
+		(codesWidth - m_patchSize) / m_gridSpacing + 1 : 0;
+	unsigned int numDescY = codesHeight >= m_patchSize ?
+		(codesHeight - m_patchSize) / m_gridSpacing + 1 : 0;
+	unsigned int numDescriptors = numDescX * numDescY;
+
+	vector<pair<int, int> > coordinates;
+	for(unsigned int y = 0; y < numDescY; y++) {
+		for(unsigned int x = 0; x < numDescX; x++) {
+			coordinates.push_back(make_pair(
+				x * m_gridSpacing + 1 + m_patchSize / 2,
+				y * m_gridSpacing + 1 + m_patchSize / 2));
+		}
+	}
+
+	vector<uint8_t> codes(codesWidth * codesHeight);
+	vector<float> descriptors(numDescriptors * m_numBins);
+	for(unsigned int i = 0; i < img->getNumChannels(); i++) {
+		computeCodes(img->getData(i), width, height, codes.data());
+		computeHistograms(codes.data(), codesWidth, codesHeight,
+			numDescX, numDescY, descriptors.data());
+
+		if(i == 0) {
+			imageFeatures->newFeatures(descriptors.data(), m_numBins,
+				numDescriptors, coordinates);
+		} else {
+			imageFeatures->extendFeatures(i, descriptors.data(),
+				numDescriptors);
+		}
+	}
+
+	return imageFeatures;
+}
+
+void LBPHistogramFeatureExtractor::computeCodes(const float* data,
+		unsigned int width, unsigned int height, uint8_t* codes) const {
+
+	// Neighbour offsets in circular order, starting on the top left corner
+	int stride = width;
+	const int offsets[8] = {
+		-stride - 1, -stride, -stride + 1, 1,
+		stride + 1, stride, stride - 1, -1
+	};
+
+	for(unsigned int y = 1; y + 1 < height; y++) {
+		const float* pixel = &data[y * width + 1];
+		for(unsigned int x = 1; x + 1 < width; x++, pixel++) {
+			uint8_t code = 0;
+			for(unsigned int n = 0; n < 8; n++) {
+				code |= (pixel[offsets[n]] > *pixel) << n;
+			}
+			*codes++ = code;
+		}
+	}
+}
+
+void LBPHistogramFeatureExtractor::computeHistograms(const uint8_t* codes,
+		unsigned int width, unsigned int height, unsigned int numDescX,
+		unsigned int numDescY, float* descriptors) const {
+
+	if(numDescX == 0 || numDescY == 0)
+		return;
+
+	// Only the integral histogram rows on the top and bottom edges of the
+	// patches are ever read, so those are the only ones kept in memory
+	unsigned int rowSize = (width + 1) * m_numBins;
+	vector<int> rowSlots(height + 1, -1);
+	unsigned int numSlots = 0;
+	for(unsigned int y = 0; y < numDescY; y++) {
+		unsigned int top = y * m_gridSpacing;
+		if(rowSlots[top] == -1)
+			rowSlots[top] = numSlots++;
+		if(rowSlots[top + m_patchSize] == -1)
+			rowSlots[top + m_patchSize] = numSlots++;
+	}
+	unsigned int lastRow = (numDescY - 1) * m_gridSpacing + m_patchSize;
+
+	vector<uint32_t> integral(numSlots * rowSize);
+	vector<uint32_t> current(rowSize, 0);
+	vector<uint32_t> rowCounts(m_numBins);
+	for(unsigned int y = 0; y <= lastRow; y++) {
+		if(rowSlots[y] != -1) {
+			copy(current.begin(), current.end(),
+				integral.begin() + rowSlots[y] * rowSize);
+		}
+		if(y == lastRow)
+			break;
+
+		fill(rowCounts.begin(), rowCounts.end(), 0);
+		const uint8_t* row = &codes[y * width];
+		for(unsigned int x = 0; x < width; x++) {
+			rowCounts[m_mapping[row[x]]]++;
+			uint32_t* cell = &current[(x + 1) * m_numBins];
+			for(unsigned int b = 0; b < m_numBins; b++) {
+				cell[b] += rowCounts[b];
+			}
+		}
+	}
+
+	// Each histogram is normalized by the number of pixels in the patch
+	float norm = 1.0f / (m_patchSize * m_patchSize);
+	for(unsigned int y = 0; y < numDescY; y++) {
+		const uint32_t* top = &integral[
+			rowSlots[y * m_gridSpacing] * rowSize];
+		const uint32_t* bottom = &integral[
+			rowSlots[y * m_gridSpacing + m_patchSize] * rowSize];
+
+		for(unsigned int x = 0; x < numDescX; x++) {
+			unsigned int left = x * m_gridSpacing * m_numBins;
+			unsigned int right = left + m_patchSize * m_numBins;
+			for(unsigned int b = 0; b < m_numBins; b++) {
+				*descriptors++ = norm * (bottom[right + b] -
+					bottom[left + b] - top[right + b] + top[left + b]);
+			}
+		}
+	}
+}
+
+unsigned int LBPHistogramFeatureExtractor::countTransitions(
+		unsigned int code) {
+
+	unsigned int rotated = ((code << 1) | (code >> 7)) & 0xFF;
+	return countBits(code ^ rotated);
+}
+
+unsigned int LBPHistogramFeatureExtractor::countBits(unsigned int code) {
+	unsigned int count = 0;
+	for(; code != 0; code >>= 1) {
+		count += code & 1;
+	}
+	return count;
+}
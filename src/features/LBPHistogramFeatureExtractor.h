@@ -0,0 +1,57 @@
+#ifndef LBP_HISTOGRAM_FEATURE_EXTRACTOR_H
+#define LBP_HISTOGRAM_FEATURE_EXTRACTOR_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "features/FeatureExtractor.h"
+#include "framework/SettingsManager.h"
+
+/**
+ * @brief Extracts histograms of "Local Binary Pattern" codes from an image.
+ *
+ * Each pixel is described by an 8 bit code packed into a single byte, with
+ * one bit per neighbour, taken in circular order. The codes are then mapped
+ * to a small number of bins and every patch is described by the histogram
+ * of the bins of its pixels.
+ *
+ * Two mappings are available:
+ * - Uniform: each pattern with at most two 0/1 transitions gets its own
+ * bin and all the others share a single bin (59 bins).
+ * - Rotation: rotation invariant uniform patterns, where uniform patterns are
+ * identified by their number of set bits (10 bins).
+ *
+ * The histograms are read from an integral histogram of the codes, so the
+ * cost of each descriptor does not depend on the patch size.
+ */
+class LBPHistogramFeatureExtractor : public FeatureExtractor {
+public:
+	/**
+	 * @brief Sets up the feature extraction parameters.
+	 *
+	 * @param settings Manager that allows any required settings
+	 * to be loaded from the configuration file.
+	 */
+	LBPHistogramFeatureExtractor(const SettingsManager* settings);
+
+	ImageFeatures* extract(const ImageData* img) const;
+
+private:
+	unsigned int m_gridSpacing;
+	unsigned int m_patchSize;
+	unsigned int m_numBins;
+	uint8_t m_mapping[256];
+
+	void computeCodes(const float* data, unsigned int width,
+		unsigned int height, uint8_t* codes) const;
+	void computeHistograms(const uint8_t* codes, unsigned int width,
+		unsigned int height, unsigned int numDescX, unsigned int numDescY,
+		float* descriptors) const;
+
+	static unsigned int countTransitions(unsigned int code);
+	static unsigned int countBits(unsigned int code);
+};
+
+#endif
@@ -0,0 +1,24 @@
+#include "PowerFeatureTransform.h"
+using namespace std;
+
+PowerFeatureTransform::PowerFeatureTransform(const SettingsManager* settings) {
+	m_alpha = settings->get<float>("features.powerAlpha", 0.5f);
+}
+
+void PowerFeatureTransform::transform(float* descriptor,
+		unsigned int descriptorSize) const {
+	
+	// The square root is by far the most common exponent and, unlike pow,
+	// it can be vectorized
+	if(m_alpha == 0.5f) {
+		#pragma omp simd
+		for(unsigned int j = 0; j < descriptorSize; j++) {
+			descriptor[j] = copysign(sqrt(fabs(descriptor[j])), descriptor[j]);
+		}
+	} else {
+		for(unsigned int j = 0; j < descriptorSize; j++) {
+			descriptor[j] = copysign(pow(fabs(descriptor[j]), m_alpha),
+				descriptor[j]);
+		}
+	}
+}
@@ -0,0 +1,32 @@
+#ifndef POWER_FEATURE_TRANSFORM_H
+#define POWER_FEATURE_TRANSFORM_H
+
+#include <cmath>
+
+#include "framework/SettingsManager.h"
+#include "features/FeatureTransform.h"
+#include "features/ImageFeatures.h"
+
+/**
+ * @brief Applies a signed power normalization to the descriptors.
+ *
+ * Every value is replaced by @f$ sign(x)|x|^\alpha @f$, which reduces the
+ * influence of the dominant components of each descriptor. The exponent is
+ * loaded from the "features.powerAlpha" setting and defaults to 0.5.
+ */
+class PowerFeatureTransform : public FeatureTransform {
+public:
+	/**
+	 * @brief Initializes an instance of the power normalization.
+	 *
+	 * @param settings Manager that allows any required settings
+	 * to be loaded from the configuration file.
+	 */
+	PowerFeatureTransform(const SettingsManager* settings);
+	void transform(float* descriptor, unsigned int descriptorSize) const;
+	
+private:
+	float m_alpha;
+};
+
+#endif
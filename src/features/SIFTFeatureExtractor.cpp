@@ -1,15 +1,21 @@
 #include "SIFTFeatureExtractor.h"
 using namespace std;
 
-SIFTFeatureExtractor::SIFTFeatureExtractor(const SettingsManager* settings) {
+SIFTFeatureExtractor::SIFTFeatureExtractor(const SettingsManager* settings) :
+		FeatureExtractor(settings) {
+	
 	m_smoothingSigma = settings->get<float>("image.smoothingSigma");
+	m_multiScale = settings->get<bool>("features.multiScale", false);
 	m_gridSpacings = settings->get<vector<int> >("features.gridSpacing");
 	m_patchSizes = settings->get<vector<int> >("features.patchSize");
 }
 
 ImageFeatures* SIFTFeatureExtractor::extract(const ImageData* img) const {
-	ImageFeatures* imageFeatures = new ImageFeatures(
-		img->getWidth(), img->getHeight(), img->getNumChannels());
+	if(m_multiScale) {
+		return extractMultiScale(img);
+	}
+	
+	ImageFeatures* imageFeatures = createFeatures(img);
 	#pragma omp critical
 	for(unsigned int h = 0; h < m_gridSpacings.size(); h++) {
 		unsigned int binSize = m_patchSizes[h] / 4.0;
@@ -54,3 +60,275 @@ ImageFeatures* SIFTFeatureExtractor::extract(const ImageData* img) const {
 	}
 	return imageFeatures;
 }
+
+// Same weighting used by VLFeat to approximate the Gaussian window of each
+// spatial bin when using a flat window
+static float binWindowMean(unsigned int binSize, unsigned int numBins,
+		unsigned int binIndex) {
+	
+	const float windowSize = 2.0;
+	float delta = binSize * (binIndex - 0.5 * (numBins - 1));
+	float sigma = binSize * windowSize;
+	
+	float acc = 0.0;
+	for(int x = -(int)binSize + 1; x <= (int)binSize - 1; x++) {
+		float z = (x - delta) / sigma;
+		acc += exp(-0.5 * z * z);
+	}
+	return acc / (2 * binSize - 1);
+}
+
+ImageFeatures* SIFTFeatureExtractor::extractMultiScale(
+		const ImageData* img) const {
+	
+	unsigned int width = img->getWidth();
+	unsigned int height = img->getHeight();
+	unsigned int numPixels = width * height;
+	unsigned int numScales = m_gridSpacings.size();
+	unsigned int numChannels = img->getNumChannels();
+	
+	vector<unsigned int> binSizes;
+	for(unsigned int h = 0; h < numScales; h++) {
+		binSizes.push_back(m_patchSizes[h] / 4.0);
+	}
+	
+	// Process the scales from the finest to the coarsest, so that each level
+	// of the scale space is obtained by further smoothing the previous one
+	vector<unsigned int> scaleOrder(numScales);
+	iota(scaleOrder.begin(), scaleOrder.end(), 0);
+	stable_sort(scaleOrder.begin(), scaleOrder.end(),
+		[&](unsigned int a, unsigned int b) {
+			return binSizes[a] < binSizes[b];
+		});
+	
+	// Descriptors only read the pooled gradients at multiples of both the bin
+	// size and the grid spacing, so the pooling can skip everything else
+	map<unsigned int, unsigned int> subsampling;
+	for(unsigned int h = 0; h < numScales; h++) {
+		unsigned int step = binSizes[h];
+		if(subsampling.count(binSizes[h])) {
+			step = subsampling[binSizes[h]];
+		}
+		unsigned int gridSpacing = m_gridSpacings[h];
+		while(gridSpacing != 0) {
+			unsigned int remainder = step % gridSpacing;
+			step = gridSpacing;
+			gridSpacing = remainder;
+		}
+		subsampling[binSizes[h]] = step;
+	}
+	
+	vector<vector<vector<float> > > descriptors(numScales,
+		vector<vector<float> >(numChannels));
+	vector<vector<pair<int, int> > > coordinates(numScales);
+	
+	vector<float> smoothed(numPixels);
+	vector<float> buffer(numPixels);
+	vector<float> gradients(numPixels * NUM_ORIENTATIONS);
+	vector<float> pooled(numPixels * NUM_ORIENTATIONS);
+	
+	for(unsigned int i = 0; i < numChannels; i++) {
+		copy(img->getData(i), img->getData(i) + numPixels, smoothed.begin());
+		double currentSigma = 0.0;
+		unsigned int pooledBinSize = 0;
+		
+		for(unsigned int h = 0; h < numScales; h++) {
+			unsigned int scale = scaleOrder[h];
+			unsigned int binSize = binSizes[scale];
+			
+			// Scales sharing the same bin size only differ on the sampling
+			// step and can reuse the same pooled gradients
+			if(binSize != pooledBinSize) {
+				double sigma = sqrt(max(0.0, pow(m_smoothingSigma, 2) +
+					pow(binSize / MAGNIFICATION, 2) - 0.25));
+				if(sigma > currentSigma) {
+					double delta = sqrt(sigma * sigma -
+						currentSigma * currentSigma);
+					vl_imsmooth_f(&buffer[0], width, &smoothed[0],
+						width, height, width, delta, delta);
+					smoothed.swap(buffer);
+					currentSigma = sigma;
+				}
+				
+				computeGradients(&smoothed[0], width, height, &gradients[0]);
+				poolGradients(&gradients[0], width, height, binSize,
+					subsampling[binSize], &pooled[0]);
+				pooledBinSize = binSize;
+			}
+			
+			vector<pair<int, int> > scaleCoordinates;
+			sampleDescriptors(&pooled[0], width, height, binSize,
+				subsampling[binSize], m_gridSpacings[scale],
+				descriptors[scale][i], scaleCoordinates);
+			if(i == 0) {
+				coordinates[scale] = scaleCoordinates;
+			}
+		}
+	}
+	
+	// Store the scales in the order they were defined in the settings
+	unsigned int totalDescriptors = 0;
+	for(unsigned int h = 0; h < numScales; h++) {
+		totalDescriptors += coordinates[h].size();
+	}
+	ImageFeatures* imageFeatures = createFeatures(img);
+	imageFeatures->reserve(totalDescriptors, DESCRIPTOR_SIZE);
+	for(unsigned int h = 0; h < numScales; h++) {
+		unsigned int numDescriptors = coordinates[h].size();
+		imageFeatures->newFeatures(descriptors[h][0].data(), DESCRIPTOR_SIZE,
+			numDescriptors, coordinates[h]);
+		for(unsigned int i = 1; i < numChannels; i++) {
+			imageFeatures->extendFeatures(i, descriptors[h][i].data(),
+				numDescriptors);
+		}
+	}
+	return imageFeatures;
+}
+
+void SIFTFeatureExtractor::computeGradients(const float* image,
+		unsigned int width, unsigned int height, float* gradients) const {
+	
+	unsigned int numPixels = width * height;
+	int stride = width;
+	fill(gradients, gradients + numPixels * NUM_ORIENTATIONS, 0.0);
+	
+	for(unsigned int y = 0; y < height; y++) {
+		for(unsigned int x = 0; x < width; x++) {
+			const float* pixel = &image[y * width + x];
+			
+			float gy;
+			if(y == 0) {
+				gy = pixel[stride] - pixel[0];
+			} else if(y == height - 1) {
+				gy = pixel[0] - pixel[-stride];
+			} else {
+				gy = 0.5 * (pixel[stride] - pixel[-stride]);
+			}
+			
+			float gx;
+			if(x == 0) {
+				gx = pixel[1] - pixel[0];
+			} else if(x == width - 1) {
+				gx = pixel[0] - pixel[-1];
+			} else {
+				gx = 0.5 * (pixel[1] - pixel[-1]);
+			}
+			
+			// Split the gradient modulus between the two closest orientations
+			float angle = vl_fast_atan2_f(gy, gx);
+			float mod = vl_fast_sqrt_f(gx * gx + gy * gy);
+			float orientation = vl_mod_2pi_f(angle) *
+				(NUM_ORIENTATIONS / (2 * VL_PI));
+			int bin = (int)vl_floor_f(orientation);
+			float weight = orientation - bin;
+			
+			unsigned int index = y * width + x;
+			gradients[(bin % NUM_ORIENTATIONS) * numPixels + index] =
+				(1 - weight) * mod;
+			gradients[((bin + 1) % NUM_ORIENTATIONS) * numPixels + index] =
+				weight * mod;
+		}
+	}
+}
+
+void SIFTFeatureExtractor::poolGradients(const float* gradients,
+		unsigned int width, unsigned int height, unsigned int binSize,
+		unsigned int subsampling, float* pooled) const {
+	
+	unsigned int numPixels = width * height;
+	unsigned int pooledWidth = (width - 1) / subsampling + 1;
+	unsigned int pooledHeight = (height - 1) / subsampling + 1;
+	
+	vector<float> buffer(width * pooledHeight);
+	for(unsigned int t = 0; t < NUM_ORIENTATIONS; t++) {
+		vl_imconvcoltri_f(&buffer[0], pooledHeight, &gradients[t * numPixels],
+			width, height, width, binSize, subsampling,
+			VL_PAD_BY_CONTINUITY | VL_TRANSPOSE);
+		vl_imconvcoltri_f(&pooled[t * pooledWidth * pooledHeight], pooledWidth,
+			&buffer[0], pooledHeight, width, pooledHeight, binSize, subsampling,
+			VL_PAD_BY_CONTINUITY | VL_TRANSPOSE);
+	}
+}
+
+void SIFTFeatureExtractor::sampleDescriptors(const float* pooled,
+		unsigned int width, unsigned int height, unsigned int binSize,
+		unsigned int subsampling, unsigned int gridSpacing,
+		vector<float>& descriptors, vector<pair<int, int> >& coordinates) const {
+	
+	unsigned int pooledWidth = (width - 1) / subsampling + 1;
+	unsigned int pooledHeight = (height - 1) / subsampling + 1;
+	unsigned int numPooled = pooledWidth * pooledHeight;
+	unsigned int pooledStep = gridSpacing / subsampling;
+	unsigned int pooledBinSize = binSize / subsampling;
+	unsigned int frameSize = binSize * (NUM_BINS - 1) + 1;
+	if(frameSize > width || frameSize > height) {
+		return;
+	}
+	
+	// The triangular kernel used for pooling has unit integral, while SIFT
+	// expects it to have unit height
+	float weights[NUM_BINS * NUM_BINS];
+	for(unsigned int biny = 0; biny < NUM_BINS; biny++) {
+		for(unsigned int binx = 0; binx < NUM_BINS; binx++) {
+			weights[biny * NUM_BINS + binx] = binSize * binSize *
+				binWindowMean(binSize, NUM_BINS, binx) *
+				binWindowMean(binSize, NUM_BINS, biny);
+		}
+	}
+	
+	unsigned int numFramesX = (width - frameSize) / gridSpacing + 1;
+	unsigned int numFramesY = (height - frameSize) / gridSpacing + 1;
+	unsigned int baseIndex = descriptors.size();
+	descriptors.resize(baseIndex +
+		numFramesX * numFramesY * DESCRIPTOR_SIZE);
+	
+	float center = 0.5 * binSize * (NUM_BINS - 1);
+	for(unsigned int y = 0; y < numFramesY; y++) {
+		for(unsigned int x = 0; x < numFramesX; x++) {
+			coordinates.push_back(make_pair(
+				x * gridSpacing + center, y * gridSpacing + center));
+		}
+	}
+	
+	// Read each pooled orientation plane sequentially, scattering the values
+	// into the descriptors
+	for(unsigned int t = 0; t < NUM_ORIENTATIONS; t++) {
+		for(unsigned int biny = 0; biny < NUM_BINS; biny++) {
+			for(unsigned int binx = 0; binx < NUM_BINS; binx++) {
+				unsigned int bin = biny * NUM_BINS + binx;
+				float* dst = &descriptors[baseIndex +
+					bin * NUM_ORIENTATIONS + t];
+				const float* src = &pooled[t * numPooled +
+					biny * pooledBinSize * pooledWidth + binx * pooledBinSize];
+				
+				for(unsigned int y = 0; y < numFramesY; y++) {
+					const float* row = src + y * pooledStep * pooledWidth;
+					for(unsigned int x = 0; x < numFramesX; x++) {
+						*dst = weights[bin] * row[x * pooledStep];
+						dst += DESCRIPTOR_SIZE;
+					}
+				}
+			}
+		}
+	}
+	
+	// Normalize, clamp and normalize again, as VLFeat does
+	for(unsigned int i = baseIndex; i < descriptors.size();
+			i += DESCRIPTOR_SIZE) {
+		
+		float* descriptor = &descriptors[i];
+		for(unsigned int pass = 0; pass < 2; pass++) {
+			float norm = 0.0;
+			for(unsigned int j = 0; j < DESCRIPTOR_SIZE; j++) {
+				if(pass == 1 && descriptor[j] > 0.2) {
+					descriptor[j] = 0.2;
+				}
+				norm += descriptor[j] * descriptor[j];
+			}
+			norm = vl_fast_sqrt_f(norm) + VL_EPSILON_F;
+			for(unsigned int j = 0; j < DESCRIPTOR_SIZE; j++) {
+				descriptor[j] /= norm;
+			}
+		}
+	}
+}
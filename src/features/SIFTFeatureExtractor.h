@@ -4,8 +4,14 @@
 extern "C" {
 	#include <vl/imopv.h>
 	#include <vl/dsift.h>
+	#include <vl/mathop.h>
 }
 
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <algorithm>
+
 #include "features/FeatureExtractor.h"
 #include "framework/SettingsManager.h"
 
@@ -14,6 +20,14 @@ extern "C" {
  *
  * These descriptors have a very high descriptive strength, allowing them
  * to achieve better classification results than other descriptors.
+ *
+ * When several grid spacings and patch sizes are defined, the multi-scale
+ * mode (@a features.multiScale) builds a single Gaussian scale space for each
+ * channel and extracts every scale from it, smoothing each scale according
+ * to its bin size, like PHOW does. The smoothing of the image itself
+ * (@a image.smoothingSigma) is added to the smoothing of every scale, so a
+ * scale is smoothed with a total sigma of
+ * sqrt(smoothingSigma^2 + (binSize / 6)^2 - 0.25).
  */
 class SIFTFeatureExtractor : public FeatureExtractor {
 public:
@@ -28,9 +42,30 @@ public:
 	ImageFeatures* extract(const ImageData* img) const;
 	
 private:
+	static const unsigned int NUM_BINS = 4;
+	static const unsigned int NUM_ORIENTATIONS = 8;
+	static const unsigned int DESCRIPTOR_SIZE =
+		NUM_BINS * NUM_BINS * NUM_ORIENTATIONS;
+	
+	// Ratio between the bin size and the smoothing applied to that scale
+	static constexpr double MAGNIFICATION = 6.0;
+
 	float m_smoothingSigma;
+	bool m_multiScale;
 	std::vector<int> m_gridSpacings;
 	std::vector<int> m_patchSizes;
+	
+	ImageFeatures* extractMultiScale(const ImageData* img) const;
+	
+	void computeGradients(const float* image, unsigned int width,
+		unsigned int height, float* gradients) const;
+	void poolGradients(const float* gradients, unsigned int width,
+		unsigned int height, unsigned int binSize, unsigned int subsampling,
+		float* pooled) const;
+	void sampleDescriptors(const float* pooled, unsigned int width,
+		unsigned int height, unsigned int binSize, unsigned int subsampling,
+		unsigned int gridSpacing, std::vector<float>& descriptors,
+		std::vector<std::pair<int, int> >& coordinates) const;
 };
 
 #endif
@@ -5,6 +5,9 @@ using namespace boost::filesystem;
 BOOST_CLASS_EXPORT(FisherCodebook);
 BOOST_CLASS_EXPORT(KMeansCodebook);
 
+// The cache name of the histograms of the train set
+static const string TRAINING_MATRIX_NAME = "trainingMatrix";
+
 typedef boost::function<FeatureExtractor*(const SettingsManager*)>
 	featureFactory_t;
 typedef boost::function<FeatureTransform*(const SettingsManager*)>
@@ -21,19 +24,38 @@ ClassificationFramework::ClassificationFramework(string datasetPath,
 		
 	m_skipCache = skipCache;
 	m_settings = settings;
+	m_codebook = nullptr;
 	
 	if(!m_settings->get<bool>("framework.verbose")) {
 		OutputHelper::disableOutput();
 	}
+	ProgressTracker::setInterval(
+		m_settings->get<double>("framework.progressInterval", 0.5));
+	
+	// Profiling is optional and collects values for the lifetime of
+	// this instance, unless the program already started it
+	enableProfiling(m_settings);
 	
 	m_cacheHelper = new CacheHelper(datasetPath, m_settings);
+	m_prefetchThreads =
+		m_settings->get<unsigned int>("framework.prefetchThreads", 2);
+	m_prefetchWindow =
+		m_settings->get<unsigned int>("framework.prefetchWindow", 64);
 	
+	// The cached split is only reused if it was made with the same seed
+	uint64_t seed = m_settings->get<uint64_t>("framework.seed", 0);
 	m_datasetManager = m_skipCache ?
 		nullptr : m_cacheHelper->load<DatasetManager>("dataset");
+	if(m_datasetManager != nullptr && m_datasetManager->getSeed() != seed) {
+		delete m_datasetManager;
+		m_datasetManager = nullptr;
+	}
 	if(m_datasetManager == nullptr) {
 		m_datasetManager = new DatasetManager(datasetPath,
-			m_settings->get<int>("classifier.trainImagesPerClass"));
+			m_settings->get<int>("classifier.trainImagesPerClass"), seed);
 		m_cacheHelper->save<DatasetManager>("dataset", m_datasetManager);
+	} else if(m_settings->get<bool>("framework.refreshDataset", true)) {
+		refreshDataset();
 	}
 	
 	// Initialize factory maps
@@ -47,10 +69,14 @@ ClassificationFramework::ClassificationFramework(string datasetPath,
 	featureFactories["SIFT"] = boost::factory<SIFTFeatureExtractor*>();
 	featureFactories["HOG"] = boost::factory<HOGFeatureExtractor*>();
 	featureFactories["LBP"] = boost::factory<LBPFeatureExtractor*>();
+	featureFactories["LBPHistogram"] =
+		boost::factory<LBPHistogramFeatureExtractor*>();
 	
 	map<string, transformFactory_t> transformFactories;
 	transformFactories["Hellinger"] =
 		boost::factory<HellingerFeatureTransform*>();
+	transformFactories["L2"] = boost::factory<L2FeatureTransform*>();
+	transformFactories["Power"] = boost::factory<PowerFeatureTransform*>();
 	
 	map<string, codebookFactory_t> codebookFactories;
 	codebookFactories["Fisher"] =
@@ -58,10 +84,6 @@ ClassificationFramework::ClassificationFramework(string datasetPath,
 	codebookFactories["KMeans"] =
 		boost::factory<KMeansCodebookGenerator*>();
 	
-	map<string, classifierFactory_t> classifierFactories;
-	classifierFactories["Linear"] = boost::factory<LinearClassifier*>();
-	classifierFactories["SVM"] = boost::factory<SVMClassifier*>();
-
 	// Create instances from the settings file using the factory maps
 	m_imageLoader =
 		loaderFactories[m_settings->get<string>("image.type")](m_settings);
@@ -69,6 +91,13 @@ ClassificationFramework::ClassificationFramework(string datasetPath,
 	m_featureExtractor =
 		featureFactories[m_settings->get<string>("features.type")](m_settings);
 	
+	map<string, ImageFeatures::Storage> featureStorages;
+	featureStorages["Float32"] = ImageFeatures::FLOAT32;
+	featureStorages["Float16"] = ImageFeatures::FLOAT16;
+	featureStorages["UInt8"] = ImageFeatures::UINT8;
+	m_featureStorage = featureStorages.at(
+		m_settings->get<string>("features.storage", "Float32"));
+	
 	vector<string> transformList =
 		m_settings->get<vector<string> >("features.transforms");
 	for(unsigned int i = 0; i < transformList.size(); i++) {
@@ -79,33 +108,134 @@ ClassificationFramework::ClassificationFramework(string datasetPath,
 	m_codebookGenerator =
 		codebookFactories[m_settings->get<string>("codebook.type")](m_settings);
 	
-	vector<string> classNames = m_datasetManager->listClasses();
-	m_classifier = classifierFactories[
-		m_settings->get<string>("classifier.type")](m_settings, classNames);
+	m_classifier = createClassifier(m_settings,
+		m_datasetManager->listClasses());
 }
 
 ClassificationFramework::~ClassificationFramework() {
 	delete m_datasetManager;
 	delete m_featureExtractor;
 	delete m_classifier;
+	delete m_codebook;
 	
 	for(unsigned int i = 0; i < m_featureTransforms.size(); i++) {
 		delete m_featureTransforms[i];
 	}
+	
+	// The budget is applied once the usage of this run is recorded
+	delete m_cacheHelper;
+	double cacheBudget = m_settings->get<double>("framework.cacheBudget", 0.0);
+	if(cacheBudget > 0.0 && m_settings->get<bool>("framework.cacheData")) {
+		uintmax_t removed =
+			CacheManager().evict(cacheBudget * 1024.0 * 1024.0);
+		if(removed > 0) {
+			OutputHelper::printMessage("Evicted " +
+				to_string(removed / (1024 * 1024)) + "MB from the cache");
+		}
+	}
+	
+	disableProfiling(m_settings);
 }
 
-ImageFeatures* ClassificationFramework::extractFeature(string imagePath) {
-	ImageFeatures* features = m_cacheHelper->load<ImageFeatures>(imagePath);
-	if(features == nullptr) {
-		// Extract features
-		ImageData* img = m_imageLoader->loadImage(imagePath);
+void ClassificationFramework::enableProfiling(
+		const SettingsManager* settings) {
+	
+	if(!settings->get<bool>("framework.profile", false) ||
+			!Profiler::enable()) {
+		return;
+	}
+	
+	double interval = settings->get<double>("framework.profileInterval", 0.0);
+	if(interval > 0.0) {
+		Profiler::startStreaming(settings->get<string>(
+			"framework.profileStream", "profile-stream.json"), interval);
+	}
+}
+
+void ClassificationFramework::disableProfiling(
+		const SettingsManager* settings) {
+	
+	if(!settings->get<bool>("framework.profile", false) ||
+			!Profiler::disable()) {
+		return;
+	}
+	
+	Profiler::stopStreaming();
+	std::ofstream ofs(settings->get<string>(
+		"framework.profileOutput", "profile.json"));
+	Profiler::writeJson(ofs);
+	ofs << endl;
+}
+
+void ClassificationFramework::refreshDataset() {
+	DatasetManager::Changes changes = m_datasetManager->refresh();
+	if(changes.empty()) {
+		return;
+	}
+	
+	// Anything derived from a changed image is stale, whatever the settings
+	// it was generated with. The new images are processed when needed.
+	for(unsigned int i = 0; i < changes.modified.size(); i++) {
+		m_cacheHelper->purge(changes.modified[i]);
+	}
+	for(unsigned int i = 0; i < changes.removed.size(); i++) {
+		m_cacheHelper->purge(changes.removed[i]);
+	}
+	if(!changes.modified.empty()) {
+		m_cacheHelper->purge(TRAINING_MATRIX_NAME);
+	}
+	m_cacheHelper->save<DatasetManager>("dataset", m_datasetManager);
+	
+	OutputHelper::printMessage("Dataset refreshed: " +
+		to_string(changes.added.size()) + " added, " +
+		to_string(changes.modified.size()) + " modified, " +
+		to_string(changes.removed.size()) + " removed");
+}
+
+void ClassificationFramework::invalidateCodebook() {
+	// The histograms were encoded with the old codebook
+	m_cacheHelper->remove<Codebook>("codebook");
+	m_cacheHelper->clear<Histogram>();
+}
+
+ImageFeatures* ClassificationFramework::computeFeature(string imagePath) {
+	ImageFeatures* features;
+	ImageData* img = m_imageLoader->loadImage(imagePath);
+	{
+		Profiler::Timer timer(Profiler::EXTRACT);
 		features = m_featureExtractor->extract(img);
-		delete img;
-		
-		// Apply transformations
-		for(unsigned int i = 0; i < m_featureTransforms.size(); i++) {
-			features = m_featureTransforms[i]->transform(features);
+	}
+	delete img;
+	
+	// Apply the whole chain of transformations to each descriptor at once
+	{
+		Profiler::Timer timer(Profiler::TRANSFORM);
+		if(!m_featureTransforms.empty()) {
+			unsigned int descriptorSize = features->getDescriptorSize();
+			for(unsigned int j = 0; j < features->getNumFeatures(); j++) {
+				float* descriptor = features->getMutableFeature(j);
+				for(unsigned int i = 0; i < m_featureTransforms.size(); i++) {
+					m_featureTransforms[i]->transform(
+						descriptor, descriptorSize);
+				}
+			}
 		}
+		features->compact(m_featureStorage);
+	}
+	
+	return features;
+}
+
+ImageFeatures* ClassificationFramework::extractFeature(string imagePath,
+		bool useCache) {
+	
+	if(!useCache) {
+		return computeFeature(imagePath);
+	}
+	
+	ImageFeatures* features = m_cacheHelper->load<ImageFeatures>(imagePath);
+	if(features == nullptr) {
+		features = computeFeature(imagePath);
 		m_cacheHelper->save<ImageFeatures>(imagePath, features);
 	}
 
@@ -113,53 +243,66 @@ ImageFeatures* ClassificationFramework::extractFeature(string imagePath) {
 }
 
 Codebook* ClassificationFramework::prepareCodebook(
-		vector<string> imagePaths, bool skipCache) {
+		vector<string> imagePaths, bool skipCache, bool saveCache) {
 
 	Codebook* codebook = skipCache ?
 		nullptr : m_cacheHelper->load<Codebook>("codebook");
 	if(codebook == nullptr) {
 		unsigned int numTextonImages =
 			m_settings->get<unsigned int>("codebook.textonImages");
-		numTextonImages = min(imagePaths.size(), numTextonImages);
+		numTextonImages = min<unsigned int>(imagePaths.size(), numTextonImages);
 		vector<ImageFeatures*> features;
 		features.resize(numTextonImages, nullptr);
 	
-		unsigned int currentIter = 0;
-		#pragma omp parallel for
-		for(unsigned int i = 0; i < numTextonImages; i++) {
-			features[i] = extractFeature(imagePaths[i]);
-		
-			#pragma omp critical
-			{
-				currentIter++;
-				OutputHelper::printProgress("Processing image "
-					+ DatasetManager::getFilename(imagePaths[i]),
-					currentIter, numTextonImages);
+		{
+			ProgressTracker progress("Processing images", numTextonImages);
+			#pragma omp parallel for
+			for(unsigned int i = 0; i < numTextonImages; i++) {
+				features[i] = extractFeature(imagePaths[i]);
+				progress.increment();
 			}
 		}
 		
 		codebook = m_codebookGenerator->generate(features);
-		m_cacheHelper->save<Codebook>("codebook", codebook);
+		if(saveCache) {
+			m_cacheHelper->save<Codebook>("codebook", codebook);
+		}
 		
 		for(unsigned int i = 0; i < features.size(); i++) {
 			delete features[i];
 		}
 	}
 	
+	// Build the encoder state now, so it can be shared by all the threads
+	codebook->prepare();
 	return codebook;
 }
 
 Histogram* ClassificationFramework::generateHistogram(
-		Codebook* codebook, string imagePath) {
+		Codebook* codebook, string imagePath, bool useCache) {
 
-	Histogram* histogram = m_skipCache ?
+	Histogram* histogram = m_skipCache || !useCache ?
 		nullptr : m_cacheHelper->load<Histogram>(imagePath);
 	if(histogram == nullptr) {
-		ImageFeatures* features = extractFeature(imagePath);
+		histogram = encodeHistogram(codebook, imagePath, useCache);
+	}
+
+	return histogram;
+}
+
+Histogram* ClassificationFramework::encodeHistogram(Codebook* codebook,
+		string imagePath, bool useCache, bool cacheFeatures) {
+	
+	ImageFeatures* features = extractFeature(imagePath, cacheFeatures);
+	Histogram* histogram;
+	{
+		Profiler::Timer timer(Profiler::ENCODE);
 		histogram = codebook->encode(features);
+	}
+	if(useCache) {
 		m_cacheHelper->save<Histogram>(imagePath, histogram);
-		delete features;
 	}
+	delete features;
 
 	return histogram;
 }
@@ -168,78 +311,293 @@ vector<Histogram*> ClassificationFramework::generateHistograms(
 		vector<string> imagePaths, bool skipCodebook) {
 		
 	OutputHelper::printMessage("Generating histograms:");
-		
-	Codebook* codebook = prepareCodebook(imagePaths, skipCodebook);
+	
+	// Keep the codebook around, it is required to encode any other images
+	// classified by this instance
+	delete m_codebook;
+	m_codebook = prepareCodebook(imagePaths, skipCodebook);
+	vector<Histogram*> histograms(imagePaths.size(), nullptr);
+
+	// The cached histograms are read ahead of the workers, which go through
+	// the images in order
+	CachePrefetcher<Histogram> prefetcher(m_cacheHelper, imagePaths,
+		m_skipCache ? 0 : m_prefetchThreads, m_prefetchWindow);
+	ProgressTracker progress("Processing images", imagePaths.size());
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int i = 0; i < imagePaths.size(); i++) {
+		histograms[i] = m_skipCache ? nullptr : prefetcher.take(i);
+		if(histograms[i] == nullptr) {
+			histograms[i] = encodeHistogram(m_codebook, imagePaths[i], true);
+		}
+		progress.increment();
+	}
+	
+	return histograms;
+}
+
+unsigned int ClassificationFramework::updateModel(
+		const vector<string>& imagePaths, const vector<string>& imageClasses) {
+	
+	if(m_codebook == nullptr) {
+		throw logic_error("classifier was not trained");
+	}
+	
+	vector<string> classNames = m_datasetManager->listClasses();
+	vector<unsigned int> classes(imageClasses.size());
+	for(unsigned int i = 0; i < imageClasses.size(); i++) {
+		vector<string>::iterator it =
+			find(classNames.begin(), classNames.end(), imageClasses[i]);
+		if(it == classNames.end()) {
+			throw invalid_argument("unknown class " + imageClasses[i]);
+		}
+		classes[i] = it - classNames.begin();
+	}
+	
+	OutputHelper::printMessage("Generating histograms:");
+	vector<Histogram*> histograms(imagePaths.size(), nullptr);
+	{
+		ProgressTracker progress("Processing images", imagePaths.size());
+		#pragma omp parallel for
+		for(unsigned int i = 0; i < imagePaths.size(); i++) {
+			try {
+				histograms[i] = generateHistogram(m_codebook, imagePaths[i]);
+			} catch(...) {
+				OutputHelper::printMessage(
+					"Could not extract enough data from the image");
+			}
+			progress.increment();
+		}
+	}
+	
+	vector<Histogram*> newHistograms;
+	vector<unsigned int> newClasses;
+	for(unsigned int i = 0; i < histograms.size(); i++) {
+		if(histograms[i] != nullptr) {
+			newHistograms.push_back(histograms[i]);
+			newClasses.push_back(classes[i]);
+		}
+	}
+	
+	exception_ptr error;
+	try {
+		m_classifier->update(newHistograms, newClasses);
+	} catch(...) {
+		error = current_exception();
+	}
+	
+	for(unsigned int i = 0; i < newHistograms.size(); i++) {
+		delete newHistograms[i];
+	}
+	if(error) {
+		rethrow_exception(error);
+	}
+	return newHistograms.size();
+}
+
+vector<Histogram*> ClassificationFramework::encodeImages(
+		const vector<string>& codebookPaths, const vector<string>& imagePaths) {
+	
+	OutputHelper::printMessage("Generating histograms:");
+	
+	delete m_codebook;
+	m_codebook = prepareCodebook(codebookPaths, true, false);
 	vector<Histogram*> histograms(imagePaths.size(), nullptr);
 
-	unsigned int currentIter = 0;
+	ProgressTracker progress("Processing images", imagePaths.size());
 	#pragma omp parallel for
 	for(unsigned int i = 0; i < imagePaths.size(); i++) {	
-		histograms[i] = generateHistogram(codebook, imagePaths[i]);
-		#pragma omp critical
-		{
-			currentIter++;
-			OutputHelper::printProgress("Processing image "
-				+ DatasetManager::getFilename(imagePaths[i]),
-				currentIter, imagePaths.size());
-		}
+		histograms[i] = generateHistogram(m_codebook, imagePaths[i], false);
+		progress.increment();
 	}
 	
-	delete codebook;			
 	return histograms;
 }
 
+void ClassificationFramework::buildCodebook() {
+	OutputHelper::printMessage("Generating codebook:");
+	delete m_codebook;
+	m_codebook = prepareCodebook(m_datasetManager->getTrainData(),
+		m_skipCache);
+}
+
+unsigned int ClassificationFramework::extractShard(unsigned int shard,
+		unsigned int numShards) {
+	
+	ShardStore store(m_cacheHelper, shard, numShards);
+	
+	vector<string> imagePaths;
+	vector<string> allPaths = m_datasetManager->getTrainData();
+	vector<string> testPaths = m_datasetManager->getTestData();
+	allPaths.insert(allPaths.end(), testPaths.begin(), testPaths.end());
+	for(unsigned int i = 0; i < allPaths.size(); i++) {
+		if(ShardStore::getShard(allPaths[i], numShards) == shard) {
+			imagePaths.push_back(allPaths[i]);
+		}
+	}
+	
+	// The histograms can only be encoded once a codebook was generated and
+	// cached, usually after merging the features of every shard
+	delete m_codebook;
+	m_codebook = m_skipCache ?
+		nullptr : m_cacheHelper->load<Codebook>("codebook");
+	store.open<ImageFeatures>();
+	if(m_codebook != nullptr) {
+		m_codebook->prepare();
+		store.open<Histogram>();
+	}
+	
+	OutputHelper::printMessage("Processing shard " + to_string(shard + 1) +
+		" of " + to_string(numShards) + ":");
+	{
+		ProgressTracker progress("Processing images", imagePaths.size());
+		#pragma omp parallel for schedule(dynamic)
+		for(unsigned int i = 0; i < imagePaths.size(); i++) {
+			try {
+				// Data already in the cache is not stored again
+				ImageFeatures* features =
+					m_cacheHelper->load<ImageFeatures>(imagePaths[i]);
+				if(features == nullptr) {
+					features = computeFeature(imagePaths[i]);
+					store.add<ImageFeatures>(imagePaths[i], features);
+				}
+				
+				Histogram* histogram = m_codebook == nullptr || m_skipCache ?
+					nullptr : m_cacheHelper->load<Histogram>(imagePaths[i]);
+				if(m_codebook != nullptr && histogram == nullptr) {
+					{
+						Profiler::Timer timer(Profiler::ENCODE);
+						histogram = m_codebook->encode(features);
+					}
+					store.add<Histogram>(imagePaths[i], histogram);
+				}
+				delete histogram;
+				delete features;
+			} catch(...) {
+				OutputHelper::printMessage(
+					"Could not extract enough data from the image");
+			}
+			progress.increment();
+		}
+	}
+	
+	store.commit();
+	return imagePaths.size();
+}
+
+unsigned int ClassificationFramework::mergeShards(unsigned int numShards) {
+	OutputHelper::printMessage("Merging " + to_string(numShards) + " shards");
+	return ShardStore::merge<ImageFeatures>(m_cacheHelper, numShards, true) +
+		ShardStore::merge<Histogram>(m_cacheHelper, numShards, false);
+}
+
+void ClassificationFramework::setFold(unsigned int fold,
+		unsigned int numFolds) {
+	
+	m_datasetManager->setFold(fold, numFolds);
+}
+
+Classifier* ClassificationFramework::createClassifier(
+		const SettingsManager* settings, vector<string> classNames) {
+	
+	map<string, classifierFactory_t> classifierFactories;
+	classifierFactories["Linear"] = boost::factory<LinearClassifier*>();
+	classifierFactories["SVM"] = boost::factory<SVMClassifier*>();
+	
+	return classifierFactories.at(settings->get<string>("classifier.type"))(
+		settings, classNames);
+}
+
 void ClassificationFramework::train() {
-	for(unsigned int i = 0; i < m_trainHistograms.size(); i++)
-		delete m_trainHistograms[i];
+	vector<string> imagePaths = m_datasetManager->getTrainData();
+	vector<unsigned int> imageClasses = m_datasetManager->getTrainClasses();
+	uint64_t fingerprint =
+		TrainingMatrix::getFingerprint(imagePaths, imageClasses);
+	
+	// The histograms of the train set are cached together, as a matrix
+	// mapped straight from the file. It is only valid with the codebook the
+	// histograms were encoded with.
+	bool useMatrix = !m_skipCache && m_cacheHelper->isEnabled();
+	string matrixPath =
+		m_cacheHelper->getFilePath<Histogram>(TRAINING_MATRIX_NAME);
+	shared_ptr<const TrainingMatrix> trainingData;
+	delete m_codebook;
+	m_codebook = useMatrix ?
+		m_cacheHelper->load<Codebook>("codebook") : nullptr;
+	if(m_codebook != nullptr) {
+		m_codebook->prepare();
+		trainingData.reset(TrainingMatrix::load(matrixPath, fingerprint));
+	}
 	
-	m_trainHistograms =
-		generateHistograms(m_datasetManager->getTrainData(), m_skipCache);
+	if(trainingData == nullptr) {
+		vector<Histogram*> histograms =
+			generateHistograms(imagePaths, m_skipCache);
+		trainingData = make_shared<const TrainingMatrix>(
+			histograms, imageClasses);
+		for(unsigned int i = 0; i < histograms.size(); i++) {
+			delete histograms[i];
+		}
+		if(useMatrix) {
+			trainingData->save(matrixPath, fingerprint);
+		}
+	}
 
-	m_classifier->train(m_trainHistograms, m_datasetManager->getTrainClasses());
+	m_classifier->train(trainingData);
 }
 
 double ClassificationFramework::testRun() {
 	vector<string> classNames = m_datasetManager->listClasses();
-	vector<string> imagePaths = m_datasetManager->getTestData();
-	vector<unsigned int> testClasses = m_datasetManager->getTestClasses();
-	Codebook* codebook = prepareCodebook(imagePaths, false);
+	unsigned int numImages =
+		m_datasetManager->getNumImages(DatasetManager::TEST);
 	
 	OutputHelper::printMessage("Testing Classifier:");
-	ConfusionMatrix confMat(classNames);
+	EvaluationAccumulator evaluation(classNames);
 	
-	double avgTime = 0.0;
-	unsigned int currentIter = 0;
-	#pragma omp parallel for
-	for(unsigned int i = 0; i < imagePaths.size(); i++) {
-		clock_t start = clock();
-		Histogram* testHist = generateHistogram(codebook, imagePaths[i]);
-		pair<unsigned int, double> result = m_classifier->classify(testHist);
-		delete testHist;
-		avgTime += (clock() - start) / (double) CLOCKS_PER_SEC;
-		
-		confMat.addEntry(testClasses[i], result.first);
-			
-		#pragma omp critical
-		{
-			currentIter++;
-						
-			if(!(currentIter % 100)) {
-				ConfusionMatrix tempMat = confMat;
-				cout << endl;
-				tempMat.printMatrix();
-				cout << "    Taking " <<
-					((avgTime / 100.0) * 1000.0) << "ms per image" << endl;
-				avgTime = 0.0;
+	// Latencies are measured in wall clock time for each image, since the
+	// process CPU time adds up the time spent by all the threads
+	double totalTime = 0.0;
+	{
+		vector<string> imagePaths = m_datasetManager->getTestData();
+		CachePrefetcher<Histogram> prefetcher(m_cacheHelper, imagePaths,
+			m_skipCache ? 0 : m_prefetchThreads, m_prefetchWindow);
+		ProgressTracker progress("Predicting images", numImages);
+		#pragma omp parallel for schedule(dynamic)
+		for(unsigned int i = 0; i < numImages; i++) {
+			chrono::steady_clock::time_point start =
+				chrono::steady_clock::now();
+			Histogram* testHist = m_skipCache ? nullptr : prefetcher.take(i);
+			if(testHist == nullptr) {
+				testHist = encodeHistogram(m_codebook, imagePaths[i], true);
 			}
-
-			OutputHelper::printResults("Predicting image", currentIter,
-				imagePaths.size(), result.first, result.second);
+			vector<pair<unsigned int, double> > ranking;
+			{
+				Profiler::Timer timer(Profiler::CLASSIFY);
+				ranking = m_classifier->rank(testHist);
+			}
+			delete testHist;
+			chrono::duration<double> elapsed =
+				chrono::steady_clock::now() - start;
+			
+			evaluation.addEntry(
+				m_datasetManager->getImageClass(DatasetManager::TEST, i),
+				ranking);
+			#pragma omp atomic
+			totalTime += elapsed.count();
+			progress.increment(ranking[0].first, ranking[0].second);
 		}
 	}
+	
+	ConfusionMatrix confMat = evaluation.getConfusionMatrix();
 	confMat.printMatrix();
+	confMat.printClassMetrics();
+	for(unsigned int k = 2; k <= evaluation.getMaxRank(); k++) {
+		cout << "    Top-" << k << " accuracy: "
+			<< evaluation.getTopAccuracy(k) * 100.0 << "%" << endl;
+	}
+	if(numImages > 0) {
+		cout << "    Taking " << (totalTime / numImages) * 1000.0
+			<< "ms per image" << endl;
+	}
 
-	delete codebook;
 	return confMat.getDiagonalAverage();
 }
 
@@ -257,36 +615,47 @@ vector<ClassificationFramework::Result> ClassificationFramework::classify(
 		imagePaths.push_back(imagesFolder);
 	}
 	
-	Codebook* codebook = prepareCodebook(imagePaths, false);
+	vector<Result> batchResults = classifyBatch(imagePaths);
 	
-	vector<string> classNames = m_datasetManager->listClasses();
+	// Only report the images we were able to classify
 	vector<Result> results;
-	unsigned int currentIter = 0;
+	for(unsigned int i = 0; i < batchResults.size(); i++) {
+		if(!batchResults[i].category.empty()) {
+			results.push_back(batchResults[i]);
+		}
+	}
+	return results;
+}
+
+vector<ClassificationFramework::Result> ClassificationFramework::classifyBatch(
+		const vector<string>& imagePaths, bool useCache) {
+	
+	vector<string> classNames = m_datasetManager->listClasses();
+	vector<Result> results(imagePaths.size());
+	ProgressTracker progress("Classifying images", imagePaths.size());
 	#pragma omp parallel for
 	for(unsigned int i = 0; i < imagePaths.size(); i++) {
+		results[i].filepath = imagePaths[i];
+		results[i].certainty = 0.0;
 		try {
-			Histogram* testHist = generateHistogram(codebook, imagePaths[i]);
-			pair<unsigned int, double> resultClass
-				= m_classifier->classify(testHist);
-			Result result;
-			result.filepath = imagePaths[i];
-			result.category = classNames[resultClass.first];
-			result.certainty = resultClass.second;
-			delete testHist;
-		
-			#pragma omp critical
+			Histogram* testHist = useCache ?
+				generateHistogram(m_codebook, imagePaths[i]) :
+				encodeHistogram(m_codebook, imagePaths[i], false, false);
+			pair<unsigned int, double> resultClass;
 			{
-				results.push_back(result);
-				currentIter++;
-				OutputHelper::printResults("Classifying image", currentIter,
-					imagePaths.size(), resultClass.first, resultClass.second);
+				Profiler::Timer timer(Profiler::CLASSIFY);
+				resultClass = m_classifier->classify(testHist);
 			}
+			results[i].category = classNames[resultClass.first];
+			results[i].certainty = resultClass.second;
+			delete testHist;
+			progress.increment(resultClass.first, resultClass.second);
 		} catch(...) {
 			OutputHelper::printMessage(
 				"Could not extract enough data from the image");
+			progress.increment();
 		}
 	}
 
-	delete codebook;
 	return results;
 }
@@ -3,23 +3,33 @@
 
 #include <fstream>
 #include <vector>
+#include <memory>
+#include <chrono>
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/functional/factory.hpp>
 
 #include "utils/CacheHelper.h"
+#include "utils/ShardStore.h"
+#include "utils/CachePrefetcher.h"
 #include "utils/DatasetManager.h"
+#include "utils/Profiler.h"
+#include "utils/ProgressTracker.h"
 #include "images/HSVImageLoader.h"
 #include "images/OpponentImageLoader.h"
 #include "images/GreyscaleImageLoader.h"
 #include "features/LBPFeatureExtractor.h"
+#include "features/LBPHistogramFeatureExtractor.h"
 #include "features/HOGFeatureExtractor.h"
 #include "features/SIFTFeatureExtractor.h"
 #include "features/HellingerFeatureTransform.h"
+#include "features/L2FeatureTransform.h"
+#include "features/PowerFeatureTransform.h"
 #include "codebook/KMeansCodebookGenerator.h"
 #include "codebook/FisherCodebookGenerator.h"
 #include "classification/SVMClassifier.h"
 #include "classification/LinearClassifier.h"
+#include "classification/EvaluationAccumulator.h"
 #include "framework/SettingsManager.h"
 
 /**
@@ -48,6 +58,11 @@ public:
 	 * generating the codebook and the histograms. This does NOT regenerate
 	 * the image descriptors since these are not random and should not change
 	 * between multiple runs.
+	 *
+	 * A cached dataset is compared against its folder when
+	 * @a framework.refreshDataset is enabled. Only the images which were
+	 * added or modified since then are processed again, the cached data of
+	 * removed and modified images is discarded and the codebook is kept.
 	 */
 	ClassificationFramework(std::string datasetPath,
 		const SettingsManager *settings, bool skipCache);
@@ -88,9 +103,168 @@ public:
 	 * @return A map relating the file path and the name of its predicted class.
 	 */
 	std::vector<Result> classify(std::string imagesFolder);
+	
+	/**
+	 * @brief Predicts the class of a batch of images.
+	 *
+	 * Unlike classify(std::string), the results are returned in the same order
+	 * as @a imagePaths and images which could not be processed are kept in
+	 * the results, with an empty @a category.
+	 *
+	 * The cache only knows an image by its path, so images which may change
+	 * without changing their path, or which are not worth keeping, should be
+	 * classified without it.
+	 *
+	 * @pre A classifier must be trained using train()
+	 *
+	 * @param imagePaths The paths of the images to be classified.
+	 * @param useCache Whether the features and histograms of the images are
+	 * loaded from, and saved to, the cache.
+	 * @return The predicted class for each image.
+	 */
+	std::vector<Result> classifyBatch(
+		const std::vector<std::string>& imagePaths, bool useCache = true);
+	
+	/**
+	 * @brief Discards the cached codebook and the histograms encoded with it.
+	 *
+	 * A dataset refresh keeps the codebook, which can become unrepresentative
+	 * after many images change. The next call to train() generates it again
+	 * from the current train set.
+	 */
+	void invalidateCodebook();
+	
+	/**
+	 * @brief Refines the trained classifier with new labelled images.
+	 *
+	 * The images are encoded with the current codebook and the classifier is
+	 * updated from them alone, without training it again. Images which
+	 * could not be processed are skipped. This must not be called while
+	 * other images are being classified.
+	 *
+	 * @pre A classifier must be trained using train()
+	 *
+	 * @param imagePaths The paths of the new images.
+	 * @param imageClasses The name of the class of each image, which must be
+	 * one of the classes of the dataset.
+	 * @return The number of images used to update the classifier.
+	 */
+	unsigned int updateModel(const std::vector<std::string>& imagePaths,
+		const std::vector<std::string>& imageClasses);
+	
+	/**
+	 * @brief Generates a codebook and encodes a set of images with it.
+	 *
+	 * Neither the codebook nor the histograms are read from or written to
+	 * the cache, but the image features are. The codebook is kept to
+	 * classify other images, replacing the one created by train().
+	 *
+	 * @param codebookPaths The images whose features are used to generate
+	 * the codebook, up to @a codebook.textonImages of them.
+	 * @param imagePaths The images to be encoded.
+	 * @return The histogram of each image of @a imagePaths. These must be
+	 * deleted by the caller.
+	 */
+	std::vector<Histogram*> encodeImages(
+		const std::vector<std::string>& codebookPaths,
+		const std::vector<std::string>& imagePaths);
+	
+	/**
+	 * @brief Generates the codebook from the train set, or loads it.
+	 *
+	 * The codebook is cached as in train(), so the histograms of the shards
+	 * can be encoded with it by extractShard().
+	 */
+	void buildCodebook();
+	
+	/**
+	 * @brief Processes one shard of the images of the dataset.
+	 *
+	 * The features of the images in the shard, and their histograms if a
+	 * codebook is cached, are stored in a ShardStore instead of the cache.
+	 * Data which is already cached is skipped. Several processes can work on
+	 * different shards at the same time, even on different machines sharing
+	 * the cache folder, as long as they use the same settings.
+	 *
+	 * @param shard The index of the shard, from 0 to @a numShards - 1.
+	 * @param numShards The number of shards the dataset is split into.
+	 * @return The number of images in the shard.
+	 */
+	unsigned int extractShard(unsigned int shard, unsigned int numShards);
+	
+	/**
+	 * @brief Moves the data of every shard into the cache.
+	 *
+	 * @pre Every shard must have been processed with extractShard().
+	 *
+	 * @param numShards The number of shards the dataset was split into.
+	 * @return The number of features and histograms merged.
+	 */
+	unsigned int mergeShards(unsigned int numShards);
+	
+	/**
+	 * @brief Splits the dataset into folds, for cross-validation.
+	 *
+	 * @see DatasetManager::setFold()
+	 *
+	 * @param fold The fold used for testing.
+	 * @param numFolds The number of folds.
+	 */
+	void setFold(unsigned int fold, unsigned int numFolds);
+	
+	/**
+	 * @brief Lists the name of all the classes in the dataset.
+	 *
+	 * @return The vector with the class names, sorted alphabetically.
+	 */
+	std::vector<std::string> listClasses() const {
+		return m_datasetManager->listClasses();
+	}
+	
+	/**
+	 * @brief Provides the dataset used by this instance.
+	 *
+	 * @return The dataset and its current split.
+	 */
+	const DatasetManager* getDatasetManager() const {
+		return m_datasetManager;
+	}
+	
+	/**
+	 * @brief Creates the classifier chosen by @a classifier.type.
+	 *
+	 * @param settings Contains the parameters of the classifier.
+	 * @param classNames The names of all classes.
+	 * @return A new, untrained classifier.
+	 */
+	static Classifier* createClassifier(const SettingsManager* settings,
+		std::vector<std::string> classNames);
+	
+	/**
+	 * @brief Starts profiling, as set by @a framework.profile.
+	 *
+	 * Every instance profiles its own lifetime. A program creating several
+	 * instances can call this first, so a single report covers all of them
+	 * instead of each instance replacing the report of the previous one.
+	 *
+	 * @param settings Contains the parameters of the profiler.
+	 */
+	static void enableProfiling(const SettingsManager* settings);
+	
+	/**
+	 * @brief Releases a call to enableProfiling().
+	 *
+	 * The last call stops profiling and writes the report to
+	 * @a framework.profileOutput.
+	 *
+	 * @param settings Contains the parameters of the profiler.
+	 */
+	static void disableProfiling(const SettingsManager* settings);
 
 private:
 	bool m_skipCache;
+	unsigned int m_prefetchThreads;
+	unsigned int m_prefetchWindow;
 	const SettingsManager* m_settings;
 	
 	CacheHelper* m_cacheHelper;
@@ -99,18 +273,23 @@ private:
 	ImageLoader* m_imageLoader;
 	FeatureExtractor* m_featureExtractor;	
 	std::vector<FeatureTransform*> m_featureTransforms;
+	ImageFeatures::Storage m_featureStorage;
 	CodebookGenerator* m_codebookGenerator;
 	Classifier* m_classifier;
+	Codebook* m_codebook;
 	
 	std::vector<std::string> m_imagePaths;
 	std::string m_cachePath;
 	
-	std::vector<Histogram*> m_trainHistograms;
-	
-	Codebook* prepareCodebook(
-		std::vector<std::string> imagePaths, bool skipCache);
-	ImageFeatures* extractFeature(std::string imagePath);
-	Histogram* generateHistogram(Codebook* codebook, std::string filePath);
+	void refreshDataset();
+	Codebook* prepareCodebook(std::vector<std::string> imagePaths,
+		bool skipCache, bool saveCache = true);
+	ImageFeatures* computeFeature(std::string imagePath);
+	ImageFeatures* extractFeature(std::string imagePath, bool useCache = true);
+	Histogram* generateHistogram(Codebook* codebook, std::string filePath,
+		bool useCache = true);
+	Histogram* encodeHistogram(Codebook* codebook, std::string filePath,
+		bool useCache, bool cacheFeatures = true);
 	
 	std::vector<ImageFeatures*> extractFeatures(
 		std::vector<std::string> imagePaths);
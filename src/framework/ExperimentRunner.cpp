@@ -0,0 +1,261 @@
+#include "ExperimentRunner.h"
+using namespace std;
+
+ExperimentRunner::ExperimentRunner(string datasetPath,
+		const SettingsManager* settings, unsigned int numFolds,
+		bool shareCodebook) {
+
+	m_datasetPath = datasetPath;
+	m_settings = settings;
+	m_numFolds = numFolds;
+	m_shareCodebook = shareCodebook;
+}
+
+void ExperimentRunner::addParameter(string nodePath, vector<string> values) {
+	// Only the classifier parameters can change without encoding the images
+	// again
+	if(nodePath.compare(0, 11, "classifier.") == 0) {
+		m_classifierParameters.push_back(make_pair(nodePath, values));
+	} else if(!CacheHelper::isCacheKey(nodePath)) {
+		// The cached features would be the same for every value
+		throw invalid_argument(nodePath +
+			" is not part of the cache folder names and cannot be swept");
+	} else {
+		m_encodingParameters.push_back(make_pair(nodePath, values));
+	}
+}
+
+vector<ExperimentRunner::Assignment> ExperimentRunner::combine(
+		const vector<pair<string, vector<string> > >& parameters) {
+
+	vector<Assignment> assignments(1);
+	for(unsigned int i = 0; i < parameters.size(); i++) {
+		vector<Assignment> extended;
+		for(unsigned int j = 0; j < assignments.size(); j++) {
+			for(unsigned int k = 0; k < parameters[i].second.size(); k++) {
+				Assignment assignment = assignments[j];
+				assignment.push_back(make_pair(
+					parameters[i].first, parameters[i].second[k]));
+				extended.push_back(assignment);
+			}
+		}
+		assignments.swap(extended);
+	}
+	return assignments;
+}
+
+string ExperimentRunner::describe(const Assignment& assignment) {
+	string description;
+	for(unsigned int i = 0; i < assignment.size(); i++) {
+		description += (i ? " " : "") +
+			assignment[i].first + "=" + assignment[i].second;
+	}
+	return description;
+}
+
+void ExperimentRunner::run() {
+	vector<Assignment> encodings = combine(m_encodingParameters);
+	vector<Assignment> classifiers = combine(m_classifierParameters);
+	unsigned int numFolds = m_numFolds >= 2 ? m_numFolds : 1;
+
+	vector<Configuration> allResults;
+	for(unsigned int e = 0; e < encodings.size(); e++) {
+		SettingsManager settings = *m_settings;
+		for(unsigned int i = 0; i < encodings[e].size(); i++) {
+			settings.parse(encodings[e][i].first, encodings[e][i].second);
+		}
+
+		vector<Configuration> results(classifiers.size());
+		for(unsigned int c = 0; c < classifiers.size(); c++) {
+			Assignment assignment = encodings[e];
+			assignment.insert(assignment.end(),
+				classifiers[c].begin(), classifiers[c].end());
+			results[c].name = assignment.empty() ?
+				"base settings" : describe(assignment);
+			results[c].encodeSeconds = 0.0;
+			results[c].trainSeconds = 0.0;
+			results[c].testSeconds = 0.0;
+			results[c].numTestImages = 0;
+		}
+
+		// The histograms are kept in memory, the cache is only used for
+		// the image features
+		ClassificationFramework framework(m_datasetPath, &settings, true);
+
+		unordered_map<string, Histogram*> sharedHistograms;
+		if(m_shareCodebook) {
+			if(numFolds > 1) {
+				framework.setFold(0, numFolds);
+			}
+			vector<string> imagePaths =
+				framework.getDatasetManager()->getTrainData();
+			vector<string> testPaths =
+				framework.getDatasetManager()->getTestData();
+			imagePaths.insert(imagePaths.end(),
+				testPaths.begin(), testPaths.end());
+
+			chrono::steady_clock::time_point start =
+				chrono::steady_clock::now();
+			vector<Histogram*> histograms =
+				framework.encodeImages(imagePaths, imagePaths);
+			chrono::duration<double> elapsed =
+				chrono::steady_clock::now() - start;
+
+			for(unsigned int i = 0; i < imagePaths.size(); i++) {
+				sharedHistograms[imagePaths[i]] = histograms[i];
+			}
+			for(unsigned int c = 0; c < results.size(); c++) {
+				results[c].encodeSeconds += elapsed.count();
+			}
+		}
+
+		for(unsigned int fold = 0; fold < numFolds; fold++) {
+			if(numFolds > 1) {
+				framework.setFold(fold, numFolds);
+			}
+			const DatasetManager* dataset = framework.getDatasetManager();
+			vector<string> trainPaths = dataset->getTrainData();
+			vector<string> testPaths = dataset->getTestData();
+
+			vector<Histogram*> trainHistograms, testHistograms;
+			if(m_shareCodebook) {
+				for(unsigned int i = 0; i < trainPaths.size(); i++) {
+					trainHistograms.push_back(
+						sharedHistograms.at(trainPaths[i]));
+				}
+				for(unsigned int i = 0; i < testPaths.size(); i++) {
+					testHistograms.push_back(
+						sharedHistograms.at(testPaths[i]));
+				}
+			} else {
+				vector<string> imagePaths = trainPaths;
+				imagePaths.insert(imagePaths.end(),
+					testPaths.begin(), testPaths.end());
+
+				chrono::steady_clock::time_point start =
+					chrono::steady_clock::now();
+				trainHistograms =
+					framework.encodeImages(trainPaths, imagePaths);
+				chrono::duration<double> elapsed =
+					chrono::steady_clock::now() - start;
+
+				testHistograms.assign(
+					trainHistograms.begin() + trainPaths.size(),
+					trainHistograms.end());
+				trainHistograms.resize(trainPaths.size());
+				for(unsigned int c = 0; c < results.size(); c++) {
+					results[c].encodeSeconds += elapsed.count();
+				}
+			}
+
+			evaluateFold(framework, settings, classifiers,
+				trainHistograms, dataset->getTrainClasses(),
+				testHistograms, dataset->getTestClasses(), results);
+
+			if(!m_shareCodebook) {
+				for(unsigned int i = 0; i < trainHistograms.size(); i++) {
+					delete trainHistograms[i];
+				}
+				for(unsigned int i = 0; i < testHistograms.size(); i++) {
+					delete testHistograms[i];
+				}
+			}
+		}
+
+		for(unordered_map<string, Histogram*>::iterator it =
+				sharedHistograms.begin(); it != sharedHistograms.end(); it++) {
+			delete it->second;
+		}
+		allResults.insert(allResults.end(), results.begin(), results.end());
+	}
+
+	printResults(allResults);
+}
+
+void ExperimentRunner::evaluateFold(ClassificationFramework& framework,
+		const SettingsManager& settings,
+		const vector<Assignment>& classifierAssignments,
+		const vector<Histogram*>& trainHistograms,
+		const vector<unsigned int>& trainClasses,
+		const vector<Histogram*>& testHistograms,
+		const vector<unsigned int>& testClasses,
+		vector<Configuration>& results) const {
+
+	OutputHelper::printMessage("Training " +
+		to_string(classifierAssignments.size()) + " classifiers");
+
+	// Every classifier reads the same copy of the training data. They are
+	// trained one after another, so each one uses every core for its own
+	// parallel loops.
+	vector<string> classNames = framework.listClasses();
+	shared_ptr<const TrainingMatrix> trainingData =
+		make_shared<const TrainingMatrix>(trainHistograms, trainClasses);
+	for(unsigned int c = 0; c < classifierAssignments.size(); c++) {
+		SettingsManager classifierSettings = settings;
+		for(unsigned int i = 0; i < classifierAssignments[c].size(); i++) {
+			classifierSettings.parse(classifierAssignments[c][i].first,
+				classifierAssignments[c][i].second);
+		}
+		Classifier* classifier = ClassificationFramework::createClassifier(
+			&classifierSettings, classNames);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		classifier->train(trainingData);
+		chrono::steady_clock::time_point trained =
+			chrono::steady_clock::now();
+
+		EvaluationAccumulator evaluation(classNames);
+		for(unsigned int i = 0; i < testHistograms.size(); i++) {
+			evaluation.addEntry(testClasses[i],
+				classifier->rank(testHistograms[i]));
+		}
+		chrono::steady_clock::time_point tested = chrono::steady_clock::now();
+		delete classifier;
+
+		results[c].accuracies.push_back(
+			evaluation.getConfusionMatrix().getDiagonalAverage());
+		results[c].trainSeconds +=
+			chrono::duration<double>(trained - start).count();
+		results[c].testSeconds +=
+			chrono::duration<double>(tested - trained).count();
+		results[c].numTestImages += testHistograms.size();
+	}
+}
+
+void ExperimentRunner::printResults(
+		const vector<Configuration>& results) const {
+
+	OutputHelper::printMessage(m_numFolds >= 2 ?
+		to_string(m_numFolds) + "-fold cross-validation results:" :
+		"Results:");
+
+	unsigned int best = 0;
+	vector<double> means(results.size(), 0.0);
+	for(unsigned int c = 0; c < results.size(); c++) {
+		const vector<double>& accuracies = results[c].accuracies;
+		double sqSum = 0.0;
+		for(unsigned int i = 0; i < accuracies.size(); i++) {
+			means[c] += accuracies[i] / accuracies.size();
+			sqSum += accuracies[i] * accuracies[i] / accuracies.size();
+		}
+		double stdev = sqrt(max(sqSum - means[c] * means[c], 0.0));
+		if(means[c] > means[best]) {
+			best = c;
+		}
+
+		double testMs = results[c].numTestImages == 0 ? 0.0 :
+			results[c].testSeconds * 1000.0 / results[c].numTestImages;
+		stringstream ss;
+		ss << fixed << setprecision(2) << results[c].name << endl
+			<< OutputHelper::indent(3) << "accuracy " << means[c] * 100.0
+			<< "% +/- " << stdev * 100.0 << "%, encoding "
+			<< results[c].encodeSeconds << "s, training "
+			<< results[c].trainSeconds << "s, testing " << testMs
+			<< "ms per image";
+		OutputHelper::printMessage(ss.str(), 2);
+	}
+
+	if(!results.empty()) {
+		OutputHelper::printMessage("Best: " + results[best].name, 1);
+	}
+}
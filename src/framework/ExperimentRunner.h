@@ -0,0 +1,112 @@
+#ifndef EXPERIMENT_RUNNER_H
+#define EXPERIMENT_RUNNER_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+
+#include "framework/ClassificationFramework.h"
+#include "framework/SettingsManager.h"
+#include "classification/EvaluationAccumulator.h"
+#include "utils/OutputHelper.h"
+
+/**
+ * @brief Evaluates several settings with k-fold cross-validation.
+ *
+ * Every combination of the given parameter values is evaluated on each fold
+ * of the dataset. The work is shared as much as the settings allow:
+ *
+ * - The image features are extracted once and cached, as usual.
+ * - The codebook and the histograms only depend on the parameters outside the
+ * @a classifier section, so they are generated once per fold for each
+ * combination of those parameters. With a shared codebook, they are generated
+ * once for all folds, from the whole dataset.
+ * - The classifier variants of the same encoding are trained on the same
+ * histograms, one after another, each one using every core.
+ *
+ * Neither the codebooks nor the histograms are written to the cache, so the
+ * cache of normal runs is left untouched.
+ */
+class ExperimentRunner {
+public:
+	/**
+	 * @brief Initializes an experiment with no parameters to sweep.
+	 *
+	 * @param datasetPath The folder containing the dataset.
+	 * @param settings The base settings, which the swept parameters override.
+	 * @param numFolds The number of folds. With less than 2 folds, the usual
+	 * train and test split of the dataset is used instead.
+	 * @param shareCodebook If enabled, a single codebook is generated from the
+	 * whole dataset and used for all folds, so every image is only encoded
+	 * once. This is faster, but the test images of each fold take part in
+	 * the unsupervised generation of its codebook.
+	 */
+	ExperimentRunner(std::string datasetPath, const SettingsManager* settings,
+		unsigned int numFolds, bool shareCodebook);
+
+	/**
+	 * @brief Adds a parameter to be swept.
+	 *
+	 * Only the classifier parameters and the settings which are part of the
+	 * cache folder names can be swept, any other parameter is rejected with
+	 * an @a invalid_argument exception.
+	 *
+	 * @param nodePath The path of the parameter in the settings, such as
+	 * @a classifier.c.
+	 * @param values The values to be evaluated.
+	 */
+	void addParameter(std::string nodePath, std::vector<std::string> values);
+
+	/**
+	 * @brief Evaluates every combination of the parameter values.
+	 *
+	 * The accuracy of each combination, along with the time spent encoding,
+	 * training and testing, is printed as a table once all of them are done.
+	 */
+	void run();
+
+private:
+	struct Configuration {
+		std::string name;
+		std::vector<double> accuracies;
+		double encodeSeconds;
+		double trainSeconds;
+		double testSeconds;
+		unsigned int numTestImages;
+	};
+
+	typedef std::vector<std::pair<std::string, std::string> > Assignment;
+
+	std::string m_datasetPath;
+	const SettingsManager* m_settings;
+	unsigned int m_numFolds;
+	bool m_shareCodebook;
+
+	std::vector<std::pair<std::string, std::vector<std::string> > >
+		m_encodingParameters;
+	std::vector<std::pair<std::string, std::vector<std::string> > >
+		m_classifierParameters;
+
+	static std::vector<Assignment> combine(const std::vector<std::pair<
+		std::string, std::vector<std::string> > >& parameters);
+	static std::string describe(const Assignment& assignment);
+
+	void evaluateFold(ClassificationFramework& framework,
+		const SettingsManager& settings,
+		const std::vector<Assignment>& classifierAssignments,
+		const std::vector<Histogram*>& trainHistograms,
+		const std::vector<unsigned int>& trainClasses,
+		const std::vector<Histogram*>& testHistograms,
+		const std::vector<unsigned int>& testClasses,
+		std::vector<Configuration>& results) const;
+
+	void printResults(const std::vector<Configuration>& results) const;
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define SETTINGS_MANAGER_H
 
 #include <boost/foreach.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -36,6 +38,90 @@ public:
 	T get(std::string nodePath) const {
 		return getImpl(nodePath, static_cast<T*>(0));
 	}
+	
+	/**
+	 * @brief Loads an optional value from the configuration data.
+	 * 
+	 * @param nodePath The identifier of the variable to be loaded
+	 * @param defaultValue The value to use when the variable is not defined
+	 * @return The value defined in the configuration file, or
+	 * @a defaultValue if there is none
+	 */
+	template<typename T>
+	T get(std::string nodePath, T defaultValue) const {
+		return m_tree.get<T>(nodePath, defaultValue);
+	}
+	
+	/**
+	 * @brief Loads a value from the configuration data as text.
+	 *
+	 * Arrays are written as their elements joined by dashes, so any value
+	 * can be part of a file name.
+	 *
+	 * @param nodePath The identifier of the variable to be loaded
+	 * @param defaultValue The text to use when the variable is not defined,
+	 * or @a nullptr if it must be defined
+	 * @return The text of the value
+	 */
+	std::string describe(std::string nodePath,
+			const char* defaultValue = nullptr) const {
+		
+		boost::optional<const boost::property_tree::ptree&> node =
+			m_tree.get_child_optional(nodePath);
+		if(!node) {
+			if(defaultValue == nullptr) {
+				// Throws the same error as a missing value in get()
+				return m_tree.get<std::string>(nodePath);
+			}
+			return defaultValue;
+		}
+		if(node->empty()) {
+			return node->data();
+		}
+		
+		std::string text;
+		BOOST_FOREACH(const boost::property_tree::ptree::value_type &v,
+				*node) {
+			
+			text += (text.empty() ? "" : "-") + v.second.data();
+		}
+		return text;
+	}
+	
+	/**
+	 * @brief Changes a value of the configuration data.
+	 *
+	 * The configuration file itself is not modified.
+	 * 
+	 * @param nodePath The identifier of the variable to be changed
+	 * @param value The new value of the variable
+	 */
+	template<typename T>
+	void set(std::string nodePath, T value) {
+		setImpl(nodePath, value);
+	}
+	
+	/**
+	 * @brief Changes a value of the configuration data from its text.
+	 *
+	 * This is the opposite of describe(). When the variable is an array, the
+	 * text holds its new elements joined by dashes.
+	 *
+	 * @param nodePath The identifier of the variable to be changed
+	 * @param text The new value of the variable, as text
+	 */
+	void parse(std::string nodePath, std::string text) {
+		boost::optional<boost::property_tree::ptree&> node =
+			m_tree.get_child_optional(nodePath);
+		if(!node || node->empty()) {
+			setImpl(nodePath, text);
+			return;
+		}
+		
+		std::vector<std::string> elements;
+		boost::split(elements, text, boost::is_any_of("-"));
+		setImpl(nodePath, elements);
+	}
 
 private:
 	boost::property_tree::ptree m_tree;
@@ -57,6 +143,22 @@ private:
 		}
 		return result;
 	}
+	
+	template<typename T>
+	void setImpl(const std::string& nodePath, const T& value) {
+		m_tree.put(nodePath, value);
+	}
+	
+	template<typename T>
+	void setImpl(const std::string& nodePath, const std::vector<T>& value) {
+		boost::property_tree::ptree array;
+		BOOST_FOREACH(const T& v, value) {
+			boost::property_tree::ptree item;
+			item.put_value(v);
+			array.push_back(std::make_pair("", item));
+		}
+		m_tree.put_child(nodePath, array);
+	}
 };
 
 #endif
@@ -13,13 +13,19 @@ ImageLoader::~ImageLoader() {
 }
 
 ImageData* ImageLoader::loadImage(std::string filename) const {
-	CImg<float> image = CImg<float>(filename.c_str());
+	CImg<float> image;
+	{
+		Profiler::Timer timer(Profiler::DECODE);
+		image = CImg<float>(filename.c_str());
+	}
 	
 	int maxSize = max(image.height(), image.width());
 	if(m_forceSize || maxSize > m_maxRes) {
+		Profiler::Timer timer(Profiler::RESIZE);
 		int resizeFactor = -100 * (m_maxRes / maxSize);
 		image = image.resize(resizeFactor, resizeFactor, -100, -100, 5);
 	}
 	
+	Profiler::Timer timer(Profiler::COLOUR);
 	return processImageData(image);
 }
@@ -8,6 +8,7 @@
 
 #include "images/ImageData.h"
 #include "framework/SettingsManager.h"
+#include "utils/Profiler.h"
 
 /**
  * @brief Loads the raw data of images.
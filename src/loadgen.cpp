@@ -0,0 +1,167 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+using namespace std;
+using namespace boost::filesystem;
+namespace po = boost::program_options;
+
+// Opens a connection to the classification server
+int connectServer(string socketPath) {
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+	
+	int clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(clientSocket < 0 ||
+			connect(clientSocket, (sockaddr*)&address, sizeof(address)) < 0) {
+		
+		close(clientSocket);
+		return -1;
+	}
+	return clientSocket;
+}
+
+// Sends one request and waits for its answer, returning false on failure
+bool sendRequest(int clientSocket, string imagePath, string& answer) {
+	string request = imagePath + "\n";
+	if(send(clientSocket, request.data(), request.size(), MSG_NOSIGNAL)
+			!= (ssize_t)request.size()) {
+		return false;
+	}
+	
+	answer.clear();
+	char data;
+	while(recv(clientSocket, &data, 1, 0) == 1) {
+		if(data == '\n') {
+			return true;
+		}
+		answer += data;
+	}
+	return false;
+}
+
+double percentile(const vector<double>& sortedValues, double fraction) {
+	if(sortedValues.empty()) {
+		return 0.0;
+	}
+	unsigned int index = min<size_t>(sortedValues.size() - 1,
+		fraction * sortedValues.size());
+	return sortedValues[index];
+}
+
+int main(int argc, char** argv) {
+	unsigned int numClients;
+	unsigned int numRequests;
+
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "print this message")
+		("images", po::value<string>(),
+			"folder containing the pictures to be sent to the server")
+		("socket", po::value<string>()->default_value("detectingnature.sock"),
+			"path of the unix domain socket the server listens on")
+		("clients", po::value<unsigned int>(&numClients)->default_value(8),
+			"number of concurrent connections")
+		("requests", po::value<unsigned int>(&numRequests)->default_value(1000),
+			"total number of requests to send")
+	;
+	
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+	
+	if(vm.count("help") || !vm.count("images")) {
+		cout << desc << endl;
+		return 1;
+	}
+	
+	vector<string> imagePaths;
+	for(recursive_directory_iterator it(vm["images"].as<string>());
+			it != recursive_directory_iterator(); it++) {
+		
+		if(is_regular_file(it->path())) {
+			imagePaths.push_back(absolute(it->path()).string());
+		}
+	}
+	if(imagePaths.empty()) {
+		cerr << "No images found" << endl;
+		return 1;
+	}
+	
+	string socketPath = vm["socket"].as<string>();
+	atomic<unsigned int> nextRequest(0);
+	atomic<unsigned int> failedRequests(0);
+	atomic<unsigned int> errorAnswers(0);
+	mutex latencyMutex;
+	vector<double> latencies;
+	
+	// Every client sends its next request as soon as the previous one
+	// is answered. ERROR answers are counted apart, so they do not take
+	// part in the throughput and latency of the classification
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<thread> clients;
+	for(unsigned int c = 0; c < numClients; c++) {
+		clients.push_back(thread([&]() {
+			int clientSocket = connectServer(socketPath);
+			if(clientSocket < 0) {
+				cerr << "Could not connect to " << socketPath << endl;
+				return;
+			}
+			
+			vector<double> clientLatencies;
+			unsigned int i;
+			string answer;
+			while((i = nextRequest++) < numRequests) {
+				chrono::steady_clock::time_point requestStart =
+					chrono::steady_clock::now();
+				if(!sendRequest(clientSocket,
+						imagePaths[i % imagePaths.size()], answer)) {
+					failedRequests++;
+					break;
+				}
+				if(answer.compare(0, 5, "ERROR") == 0) {
+					errorAnswers++;
+					continue;
+				}
+				clientLatencies.push_back(chrono::duration<double, milli>(
+					chrono::steady_clock::now() - requestStart).count());
+			}
+			close(clientSocket);
+			
+			lock_guard<mutex> lock(latencyMutex);
+			latencies.insert(latencies.end(),
+				clientLatencies.begin(), clientLatencies.end());
+		}));
+	}
+	
+	for(unsigned int c = 0; c < clients.size(); c++) {
+		clients[c].join();
+	}
+	double elapsed = chrono::duration<double>(
+		chrono::steady_clock::now() - start).count();
+	
+	sort(latencies.begin(), latencies.end());
+	cout << "Requests:   " << latencies.size() << " (" << errorAnswers
+		<< " errors, " << failedRequests << " failed)" << endl;
+	cout << "Throughput: " << latencies.size() / elapsed << " req/s" << endl;
+	cout << "Latency p50: " << percentile(latencies, 0.50) << " ms" << endl;
+	cout << "Latency p99: " << percentile(latencies, 0.99) << " ms" << endl;
+	cout << "Latency max: " << percentile(latencies, 1.0) << " ms" << endl;
+	
+	return latencies.empty();
+}
@@ -1,12 +1,15 @@
+#include <iomanip>
+
 #include <boost/program_options.hpp>
 
 #include "framework/ClassificationFramework.h"
+#include "framework/ExperimentRunner.h"
 
 using namespace std;
 namespace po = boost::program_options;
 
 int main(int argc, char** argv) {
-	unsigned int numRuns;
+	unsigned int numRuns, numFolds;
 
 	// Parse command line settings using boost
 	po::options_description desc("Allowed options");
@@ -20,6 +23,23 @@ int main(int argc, char** argv) {
 			"number of times to run the classifier")
 		("classify", po::value<string>(),
 			"folder containing pictures to be classified")
+		("folds", po::value<unsigned int>(&numFolds)->default_value(0),
+			"evaluate with k-fold cross-validation")
+		("grid", po::value<vector<string> >()->composing(),
+			"parameter to sweep, as path=value1,value2,... (repeatable)")
+		("share-codebook",
+			"use one codebook for all folds, encoding each image once; it is "
+			"built from every image, including the test images of each fold")
+		("rebuild-codebook",
+			"discard the cached codebook and histograms before training")
+		("shard", po::value<string>(),
+			"extract shard i/N of the dataset, with 0 <= i < N")
+		("merge-shards", po::value<unsigned int>(),
+			"merge the N processed shards into the cache")
+		("build-codebook",
+			"generate the codebook from the cached features and exit")
+		("cache-stats",
+			"print the size and hit rate of each cache folder and exit")
 	;
 	
 	po::variables_map vm;
@@ -30,6 +50,24 @@ int main(int argc, char** argv) {
 		cout << desc << endl;
 		return 1;
 	}
+	
+	if(vm.count("cache-stats")) {
+		vector<CacheManager::Usage> usage = CacheManager().getUsage();
+		uintmax_t totalBytes = 0;
+		for(unsigned int i = 0; i < usage.size(); i++) {
+			uint64_t loads = usage[i].hits + usage[i].misses;
+			cout << usage[i].folder << endl << "   " << fixed
+				<< setprecision(1) << usage[i].bytes / (1024.0 * 1024.0)
+				<< "MB in " << usage[i].entries << " entries, "
+				<< usage[i].hits << " hits, " << usage[i].misses
+				<< " misses (" << (loads ? 100.0 * usage[i].hits / loads : 0.0)
+				<< "% hit rate)" << endl;
+			totalBytes += usage[i].bytes;
+		}
+		cout << "Total: " << fixed << setprecision(1)
+			<< totalBytes / (1024.0 * 1024.0) << "MB" << endl;
+		return 0;
+	}
 
 	string datasetPath;
 	if(vm.count("dataset")) {
@@ -42,11 +80,54 @@ int main(int argc, char** argv) {
 	// Load classification parameters from the given XML file
 	SettingsManager settings(vm["settings"].as<string>());
 	
-	// Choose one of two modes:
+	// Choose one of the modes:
+	//  - process one shard of the dataset, merge the shards or generate the
+	//    codebook, to spread the work over several processes
 	//  - classify unknown pictures
+	//  - cross-validate and sweep parameters
 	//  - classify known pictures to get accuracy statistics
-	if(vm.count("classify")) {
+	if(vm.count("shard")) {
+		vector<string> shard;
+		string shardValue = vm["shard"].as<string>();
+		boost::split(shard, shardValue, boost::is_any_of("/"));
+		
+		// Both numbers must be plain decimals small enough for an unsigned
+		// int, stoul alone accepts a sign or trailing text
+		unsigned long shardIndex = 0, numShards = 0;
+		bool valid = shard.size() == 2;
+		for(unsigned int i = 0; i < shard.size() && valid; i++) {
+			valid = !shard[i].empty() && shard[i].size() <= 9 &&
+				boost::all(shard[i], boost::is_digit());
+		}
+		if(valid) {
+			shardIndex = stoul(shard[0]);
+			numShards = stoul(shard[1]);
+			valid = shardIndex < numShards;
+		}
+		if(!valid) {
+			cout << "Invalid shard: " << shardValue << endl;
+			return 1;
+		}
+		
+		ClassificationFramework cf(datasetPath, &settings, false);
+		cf.extractShard(shardIndex, numShards);
+		
+	} else if(vm.count("merge-shards")) {
+		ClassificationFramework cf(datasetPath, &settings, false);
+		cf.mergeShards(vm["merge-shards"].as<unsigned int>());
+		
+	} else if(vm.count("build-codebook")) {
+		ClassificationFramework cf(datasetPath, &settings, false);
+		if(vm.count("rebuild-codebook")) {
+			cf.invalidateCodebook();
+		}
+		cf.buildCodebook();
+		
+	} else if(vm.count("classify")) {
 		ClassificationFramework cf(datasetPath, &settings, numRuns != 1);
+		if(vm.count("rebuild-codebook")) {
+			cf.invalidateCodebook();
+		}
 		cf.train();
 		vector<ClassificationFramework::Result> results =
 			cf.classify(vm["classify"].as<string>());
@@ -58,14 +139,52 @@ int main(int argc, char** argv) {
 				<< " (" << it->certainty << ")" << endl;
 		}
 		
+	} else if(numFolds > 0 || vm.count("grid")) {
+		ExperimentRunner runner(datasetPath, &settings, numFolds,
+			vm.count("share-codebook"));
+		
+		vector<string> grid;
+		if(vm.count("grid")) {
+			grid = vm["grid"].as<vector<string> >();
+		}
+		for(unsigned int i = 0; i < grid.size(); i++) {
+			vector<string> parameter, values;
+			boost::split(parameter, grid[i], boost::is_any_of("="));
+			if(parameter.size() != 2) {
+				cout << "Invalid parameter: " << grid[i] << endl;
+				return 1;
+			}
+			boost::split(values, parameter[1], boost::is_any_of(","));
+			try {
+				runner.addParameter(parameter[0], values);
+			} catch(const invalid_argument& e) {
+				cout << "Invalid parameter: " << e.what() << endl;
+				return 1;
+			}
+		}
+		
+		// A single profile covers every framework of the sweep
+		ClassificationFramework::enableProfiling(&settings);
+		runner.run();
+		ClassificationFramework::disableProfiling(&settings);
+		
 	} else {
-		// Classify the known image 'numRuns' times
+		// Classify the known image 'numRuns' times, each run splitting the
+		// dataset with a different seed. The caches depend on the seed, so
+		// they remain valid for every run, as does a single profile.
 		double results[numRuns];
+		uint64_t seed = settings.get<uint64_t>("framework.seed", 0);
+		ClassificationFramework::enableProfiling(&settings);
 		for(unsigned int i = 0; i < numRuns; i++) {
-			ClassificationFramework cf(datasetPath, &settings, numRuns != 1);
+			settings.set("framework.seed", seed + i);
+			ClassificationFramework cf(datasetPath, &settings, false);
+			if(vm.count("rebuild-codebook")) {
+				cf.invalidateCodebook();
+			}
 			cf.train();
 			results[i] = cf.testRun();
 		}
+		ClassificationFramework::disableProfiling(&settings);
 		
 		// Calculate the (mean +/- std dev) stats for the runs
 		double sum = accumulate(results, results + numRuns, 0.0);
@@ -0,0 +1,64 @@
+#include <boost/program_options.hpp>
+
+#include "framework/ClassificationFramework.h"
+#include "server/ClassificationServer.h"
+
+using namespace std;
+namespace po = boost::program_options;
+
+int main(int argc, char** argv) {
+	unsigned int maxBatchSize;
+	unsigned int maxBatchDelay;
+	unsigned int maxClients;
+
+	// Parse command line settings using boost
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "print this message")
+		("dataset", po::value<string>(),
+			"folder containing the dataset to use for training")
+		("settings", po::value<string>()->default_value("settings.json"),
+			"file containing all the classification parameters")
+		("socket", po::value<string>()->default_value("detectingnature.sock"),
+			"path of the unix domain socket to listen on")
+		("batch-size", po::value<unsigned int>(&maxBatchSize)->default_value(16),
+			"maximum number of images classified together")
+		("batch-delay", po::value<unsigned int>(&maxBatchDelay)->default_value(5),
+			"milliseconds to wait for a batch to fill up")
+		("max-clients", po::value<unsigned int>(&maxClients)->default_value(64),
+			"maximum number of clients served at once")
+		("socket-mode", po::value<string>()->default_value("600"),
+			"octal permissions of the socket, controlling who can connect")
+	;
+	
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	po::notify(vm);
+	
+	if(vm.count("help") || !vm.count("dataset")) {
+		cout << desc << endl;
+		return 1;
+	}
+	
+	string socketMode = vm["socket-mode"].as<string>();
+	if(socketMode.empty() || socketMode.size() > 4 ||
+			socketMode.find_first_not_of("01234567") != string::npos ||
+			stoul(socketMode, nullptr, 8) > 0777) {
+		cout << "Invalid socket mode: " << socketMode << endl;
+		return 1;
+	}
+	
+	// Load classification parameters from the given JSON file
+	SettingsManager settings(vm["settings"].as<string>());
+	
+	// Train (or load from the cache) the model only once and reuse it for
+	// every request
+	ClassificationFramework cf(vm["dataset"].as<string>(), &settings, false);
+	cf.train();
+	
+	ClassificationServer server(&cf, vm["socket"].as<string>(),
+		maxBatchSize, maxBatchDelay, maxClients, stoul(socketMode, nullptr, 8));
+	server.run();
+	
+	return 0;
+}
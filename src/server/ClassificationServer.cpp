@@ -0,0 +1,196 @@
+#include "ClassificationServer.h"
+using namespace std;
+
+ClassificationServer::ClassificationServer(ClassificationFramework* framework,
+		string socketPath, unsigned int maxBatchSize,
+		unsigned int maxBatchDelay, unsigned int maxClients,
+		mode_t socketMode) : m_maxBatchDelay(maxBatchDelay) {
+	
+	m_framework = framework;
+	m_socketPath = socketPath;
+	m_maxBatchSize = max(maxBatchSize, 1u);
+	m_maxClients = max(maxClients, 1u);
+	m_numClients = 0;
+	
+	sockaddr_un address;
+	if(m_socketPath.size() >= sizeof(address.sun_path)) {
+		throw invalid_argument("socket path is too long");
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, m_socketPath.c_str());
+	
+	m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(m_socket < 0) {
+		throw runtime_error("could not create socket: " +
+			string(strerror(errno)));
+	}
+	
+	// The socket is created without any permission beyond the requested
+	// ones, so no other user can connect before they are set
+	unlink(m_socketPath.c_str());
+	mode_t umaskMode = umask(~socketMode & 0777);
+	int bound = bind(m_socket, (sockaddr*)&address, sizeof(address));
+	umask(umaskMode);
+	if(bound < 0 || chmod(m_socketPath.c_str(), socketMode) < 0 ||
+			listen(m_socket, SOMAXCONN) < 0) {
+		
+		close(m_socket);
+		throw runtime_error("could not listen on " + m_socketPath + ": " +
+			string(strerror(errno)));
+	}
+}
+
+ClassificationServer::~ClassificationServer() {
+	close(m_socket);
+	unlink(m_socketPath.c_str());
+}
+
+void ClassificationServer::run() {
+	thread batchThread(&ClassificationServer::processBatches, this);
+	batchThread.detach();
+	
+	OutputHelper::printMessage("Listening on " + m_socketPath);
+	while(true) {
+		// Further connections wait in the backlog until a client leaves
+		{
+			unique_lock<mutex> lock(m_clientsMutex);
+			m_clientsCondition.wait(lock, [&]{
+				return m_numClients < m_maxClients;
+			});
+		}
+		
+		int clientSocket = accept(m_socket, nullptr, nullptr);
+		if(clientSocket < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			throw runtime_error("could not accept connection: " +
+				string(strerror(errno)));
+		}
+		
+		{
+			lock_guard<mutex> lock(m_clientsMutex);
+			m_numClients++;
+		}
+		thread clientThread([this, clientSocket]() {
+			handleClient(clientSocket);
+			{
+				lock_guard<mutex> lock(m_clientsMutex);
+				m_numClients--;
+			}
+			m_clientsCondition.notify_one();
+		});
+		clientThread.detach();
+	}
+}
+
+future<ClassificationFramework::Result> ClassificationServer::enqueue(
+		string imagePath) {
+	
+	Request* request = new Request();
+	request->imagePath = imagePath;
+	future<ClassificationFramework::Result> result =
+		request->result.get_future();
+	
+	{
+		lock_guard<mutex> lock(m_queueMutex);
+		m_queue.push_back(request);
+	}
+	m_queueCondition.notify_one();
+	
+	return result;
+}
+
+void ClassificationServer::processBatches() {
+	while(true) {
+		vector<Request*> batch;
+		{
+			unique_lock<mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [&]{ return !m_queue.empty(); });
+			
+			// Give other clients a chance to join this batch
+			chrono::steady_clock::time_point deadline =
+				chrono::steady_clock::now() + m_maxBatchDelay;
+			m_queueCondition.wait_until(lock, deadline, [&]{
+				return m_queue.size() >= m_maxBatchSize;
+			});
+			
+			while(!m_queue.empty() && batch.size() < m_maxBatchSize) {
+				batch.push_back(m_queue.front());
+				m_queue.pop_front();
+			}
+		}
+		
+		vector<string> imagePaths;
+		for(unsigned int i = 0; i < batch.size(); i++) {
+			imagePaths.push_back(batch[i]->imagePath);
+		}
+		
+		// Clients may reuse a path for a new image, and their images do not
+		// belong in the cache of the dataset
+		vector<ClassificationFramework::Result> results =
+			m_framework->classifyBatch(imagePaths, false);
+		for(unsigned int i = 0; i < batch.size(); i++) {
+			batch[i]->result.set_value(results[i]);
+			delete batch[i];
+		}
+	}
+}
+
+void ClassificationServer::handleClient(int clientSocket) {
+	string buffer;
+	char data[4096];
+	
+	ssize_t received;
+	while((received = recv(clientSocket, data, sizeof(data), 0)) > 0) {
+		buffer.append(data, received);
+		
+		// Queue every complete request before waiting for the answers, so
+		// pipelined requests from one client can share a batch
+		vector<future<ClassificationFramework::Result> > pending;
+		size_t lineEnd;
+		while((lineEnd = buffer.find('\n')) != string::npos) {
+			string imagePath = buffer.substr(0, lineEnd);
+			buffer.erase(0, lineEnd + 1);
+			boost::trim(imagePath);
+			if(!imagePath.empty()) {
+				pending.push_back(enqueue(imagePath));
+			}
+		}
+		
+		stringstream answer;
+		for(unsigned int i = 0; i < pending.size(); i++) {
+			ClassificationFramework::Result result = pending[i].get();
+			if(result.category.empty()) {
+				answer << "ERROR could not classify " << result.filepath;
+			} else {
+				answer << result.category << " " << result.certainty;
+			}
+			answer << "\n";
+		}
+		
+		// A request longer than any path is never going to end
+		bool tooLong = buffer.size() > PATH_MAX;
+		if(tooLong) {
+			answer << "ERROR request is too long\n";
+		}
+		
+		string answerData = answer.str();
+		size_t sent = 0;
+		while(sent < answerData.size()) {
+			ssize_t count = send(clientSocket, answerData.data() + sent,
+				answerData.size() - sent, MSG_NOSIGNAL);
+			if(count <= 0) {
+				close(clientSocket);
+				return;
+			}
+			sent += count;
+		}
+		if(tooLong) {
+			break;
+		}
+	}
+	
+	close(clientSocket);
+}
@@ -0,0 +1,98 @@
+#ifndef CLASSIFICATION_SERVER_H
+#define CLASSIFICATION_SERVER_H
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <condition_variable>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "framework/ClassificationFramework.h"
+
+/**
+ * @brief Serves classification requests over a Unix domain socket.
+ *
+ * The server uses a single, previously trained, ClassificationFramework to
+ * answer every request, so the model is only loaded once. Requests arriving
+ * at the same time from different clients are grouped into small batches,
+ * which are then processed in parallel by the framework. The images of the
+ * requests are never cached, so a path can be reused for a new image.
+ *
+ * The protocol is line based. Each request is the path of an image, readable
+ * by the server, followed by a new line. Each answer is either
+ * <tt>category certainty</tt> or <tt>ERROR message</tt>, followed by a new
+ * line. Answers are sent in the same order the requests were received. A
+ * request longer than any path is answered with an error, and the connection
+ * is closed.
+ *
+ * Each client is served by its own thread. Once the maximum number of clients
+ * is connected, new connections wait in the backlog of the socket until
+ * another client disconnects.
+ */
+class ClassificationServer {
+public:
+	/**
+	 * @brief Initializes the server parameters.
+	 *
+	 * @param framework A trained framework used to classify all the images.
+	 * @param socketPath The filesystem path of the Unix domain socket. Any
+	 * existing file at this path will be removed.
+	 * @param maxBatchSize The largest number of images classified at once.
+	 * @param maxBatchDelay How long to wait for more requests to arrive
+	 * before processing an incomplete batch, in milliseconds.
+	 * @param maxClients The largest number of clients served at once.
+	 * @param socketMode The permissions of the socket, which control the
+	 * users allowed to connect. They do not depend on the umask.
+	 */
+	ClassificationServer(ClassificationFramework* framework,
+		std::string socketPath, unsigned int maxBatchSize,
+		unsigned int maxBatchDelay, unsigned int maxClients,
+		mode_t socketMode);
+	~ClassificationServer();
+	
+	/**
+	 * @brief Accepts and answers requests until the process is terminated.
+	 */
+	void run();
+
+private:
+	struct Request {
+		std::string imagePath;
+		std::promise<ClassificationFramework::Result> result;
+	};
+
+	ClassificationFramework* m_framework;
+	std::string m_socketPath;
+	unsigned int m_maxBatchSize;
+	std::chrono::milliseconds m_maxBatchDelay;
+	unsigned int m_maxClients;
+	int m_socket;
+	
+	std::mutex m_clientsMutex;
+	std::condition_variable m_clientsCondition;
+	unsigned int m_numClients;
+	
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCondition;
+	std::deque<Request*> m_queue;
+	
+	void processBatches();
+	void handleClient(int clientSocket);
+	std::future<ClassificationFramework::Result> enqueue(
+		std::string imagePath);
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include "CacheCodec.h"
+using namespace std;
+
+// Higher levels compress better but write much slower
+static const int ZSTD_LEVEL = 1;
+
+CacheCodec::Codec CacheCodec::fromName(string name) {
+	if(name == "None") {
+		return NONE;
+	} else if(name == "LZ4") {
+		return LZ4;
+	} else if(name == "Zstd") {
+		return ZSTD;
+	} else {
+		throw runtime_error("unknown cache compression " + name);
+	}
+}
+
+bool CacheCodec::isAvailable(Codec codec) {
+	switch(codec) {
+		case NONE:
+			return true;
+		case LZ4:
+#ifdef HAVE_LZ4
+			return true;
+#else
+			return false;
+#endif
+		case ZSTD:
+#ifdef HAVE_ZSTD
+			return true;
+#else
+			return false;
+#endif
+		default:
+			return false;
+	}
+}
+
+string CacheCodec::encode(const string& data, Codec codec,
+		unsigned int shuffleWidth) {
+
+	string shuffled;
+	const string* input = &data;
+	if(shuffleWidth > 1) {
+		shuffled.resize(data.size());
+		shuffle(data.data(), &shuffled[0], data.size(), shuffleWidth);
+		input = &shuffled;
+	}
+
+	string output;
+	switch(codec) {
+#ifdef HAVE_LZ4
+		case LZ4: {
+			output.resize(LZ4_compressBound(input->size()));
+			int size = LZ4_compress_default(input->data(), &output[0],
+				input->size(), output.size());
+			if(size <= 0) {
+				throw runtime_error("LZ4 compression failed");
+			}
+			output.resize(size);
+			break;
+		}
+#endif
+#ifdef HAVE_ZSTD
+		case ZSTD: {
+			output.resize(ZSTD_compressBound(input->size()));
+			size_t size = ZSTD_compress(&output[0], output.size(),
+				input->data(), input->size(), ZSTD_LEVEL);
+			if(ZSTD_isError(size)) {
+				throw runtime_error(string("Zstd compression failed: ") +
+					ZSTD_getErrorName(size));
+			}
+			output.resize(size);
+			break;
+		}
+#endif
+		case NONE:
+			output = *input;
+			break;
+		default:
+			throw logic_error("cache compression is not available");
+	}
+	return output;
+}
+
+bool CacheCodec::decode(const char* data, size_t size, Codec codec,
+		unsigned int shuffleWidth, size_t rawSize, vector<char>& output) {
+
+	vector<char> shuffled;
+	vector<char>& decoded = shuffleWidth > 1 ? shuffled : output;
+	decoded.resize(rawSize);
+
+	switch(codec) {
+#ifdef HAVE_LZ4
+		case LZ4:
+			if(LZ4_decompress_safe(data, decoded.data(), size, rawSize) !=
+					(int) rawSize) {
+				return false;
+			}
+			break;
+#endif
+#ifdef HAVE_ZSTD
+		case ZSTD:
+			if(ZSTD_decompress(decoded.data(), rawSize, data, size) !=
+					rawSize) {
+				return false;
+			}
+			break;
+#endif
+		case NONE:
+			if(size != rawSize) {
+				return false;
+			}
+			memcpy(decoded.data(), data, size);
+			break;
+		default:
+			return false;
+	}
+
+	if(shuffleWidth > 1) {
+		output.resize(rawSize);
+		unshuffle(shuffled.data(), output.data(), rawSize, shuffleWidth);
+	}
+	return true;
+}
+
+void CacheCodec::shuffle(const char* input, char* output, size_t size,
+		unsigned int width) {
+
+	size_t count = size / width;
+	for(size_t i = 0; i < count; i++) {
+		for(unsigned int j = 0; j < width; j++) {
+			output[j * count + i] = input[i * width + j];
+		}
+	}
+	memcpy(output + count * width, input + count * width, size % width);
+}
+
+void CacheCodec::unshuffle(const char* input, char* output, size_t size,
+		unsigned int width) {
+
+	size_t count = size / width;
+	for(size_t i = 0; i < count; i++) {
+		for(unsigned int j = 0; j < width; j++) {
+			output[i * width + j] = input[j * count + i];
+		}
+	}
+	memcpy(output + count * width, input + count * width, size % width);
+}
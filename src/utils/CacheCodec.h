@@ -0,0 +1,112 @@
+#ifndef CACHE_CODEC_H
+#define CACHE_CODEC_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef HAVE_LZ4
+	#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+	#include <zstd.h>
+#endif
+
+/**
+ * @brief Compresses the entries of the cache.
+ *
+ * The codecs are optional and only available when their library was found
+ * while building. Both favour speed over ratio, since the cache is read much
+ * more often than it is written.
+ *
+ * Most of the cached data are arrays of floating point numbers, whose high
+ * bytes are very regular and whose low bytes are almost random. Shuffling the
+ * bytes, so the first byte of every number comes first, then the second byte
+ * of every number and so on, lets the codecs find the regular runs. The
+ * arrays do not need to be aligned with the start of the data, each byte of a
+ * number still ends up in the same group as the matching bytes of the others.
+ */
+class CacheCodec {
+public:
+	/**
+	 * @brief The supported codecs, as stored in the cache entries.
+	 */
+	enum Codec {
+		NONE = 0, /**< the data is stored as is */
+		LZ4 = 1,  /**< LZ4, very fast */
+		ZSTD = 2  /**< Zstandard at a low level, fast with a better ratio */
+	};
+
+	/**
+	 * @brief Finds a codec from its name in the settings.
+	 *
+	 * @param name One of @a None, @a LZ4 or @a Zstd.
+	 * @return The matching codec.
+	 */
+	static Codec fromName(std::string name);
+
+	/**
+	 * @brief Checks whether a codec was built in.
+	 *
+	 * @param codec The codec to check.
+	 * @return @a true if data can be compressed and decompressed with it.
+	 */
+	static bool isAvailable(Codec codec);
+
+	/**
+	 * @brief Compresses a block of data.
+	 *
+	 * @pre The codec must be available.
+	 *
+	 * @param data The data to be compressed.
+	 * @param codec The codec used.
+	 * @param shuffleWidth The size of the numbers whose bytes are shuffled
+	 * before compressing, or 1 to leave the bytes in place.
+	 * @return The compressed data.
+	 */
+	static std::string encode(const std::string& data, Codec codec,
+		unsigned int shuffleWidth);
+
+	/**
+	 * @brief Decompresses a block of data.
+	 *
+	 * @param data The compressed data.
+	 * @param size The size of the compressed data.
+	 * @param codec The codec used to compress it.
+	 * @param shuffleWidth The shuffle width used to compress it.
+	 * @param rawSize The size of the data before it was compressed.
+	 * @param output Where the decompressed data is written.
+	 * @return @a false if the data could not be decompressed.
+	 */
+	static bool decode(const char* data, size_t size, Codec codec,
+		unsigned int shuffleWidth, size_t rawSize, std::vector<char>& output);
+
+	/**
+	 * @brief Groups the bytes of an array of numbers by their position.
+	 *
+	 * Any bytes after the last whole number are copied unchanged.
+	 *
+	 * @param input The array of numbers.
+	 * @param output Where the shuffled bytes are written, with the same size
+	 * as @a input.
+	 * @param size The size of the array in bytes.
+	 * @param width The size of each number in bytes.
+	 */
+	static void shuffle(const char* input, char* output, size_t size,
+		unsigned int width);
+
+	/**
+	 * @brief Reverts shuffle().
+	 *
+	 * @param input The shuffled bytes.
+	 * @param output Where the array of numbers is written.
+	 * @param size The size of the array in bytes.
+	 * @param width The size of each number in bytes.
+	 */
+	static void unshuffle(const char* input, char* output, size_t size,
+		unsigned int width);
+};
+
+#endif
@@ -5,6 +5,314 @@ CacheHelper::CacheHelper(string datasetPath, const SettingsManager* settings) {
 	m_datasetPath = datasetPath;
 	m_settings = settings;
 	m_enabled = m_settings->get<bool>("framework.cacheData");
+	
+	string codecName =
+		m_settings->get<string>("framework.cacheCompression", "None");
+	m_codec = CacheCodec::fromName(codecName);
+	m_shuffle = m_settings->get<bool>("framework.cacheShuffle", true);
+	if(m_enabled && !CacheCodec::isAvailable(m_codec)) {
+		OutputHelper::printMessage("Cache compression " + codecName +
+			" was not built, the cache is stored uncompressed");
+		m_codec = CacheCodec::NONE;
+	}
+}
+
+CacheHelper::~CacheHelper() {
+	for(map<string, pair<uint64_t, uint64_t> >::iterator it = m_usage.begin();
+			it != m_usage.end(); it++) {
+		CacheManager::recordUsage(it->first,
+			it->second.first, it->second.second);
+	}
+}
+
+// Every entry starts with a header holding the CRC-32 and the length of the
+// stored data, followed by how the archive was compressed. The CRC covers the
+// rest of the header too, so a damaged length or codec is never used to
+// decode. Before that the CRC only covered the data, entries saved before the
+// compression was added have a shorter header, and older ones hold the
+// archive alone.
+static const char ENTRY_MAGIC[4] = {'D', 'N', 'C', '3'};
+static const char ENTRY_MAGIC_V2[4] = {'D', 'N', 'C', '2'};
+static const char ENTRY_MAGIC_V1[4] = {'D', 'N', 'C', '1'};
+
+struct EntryHeaderV1 {
+	char magic[4];
+	uint32_t crc;
+	uint64_t length;
+};
+
+struct EntryHeader {
+	char magic[4];
+	uint32_t crc;
+	uint64_t length;
+	uint64_t rawLength;
+	uint8_t codec;
+	uint8_t shuffleWidth;
+	uint8_t reserved[6];
+};
+
+// The fields of the header following the CRC
+static const size_t CHECKED_HEADER_OFFSET = offsetof(EntryHeader, length);
+
+static uint32_t getChecksum(const EntryHeader& header, const char* data,
+		bool coversHeader) {
+	
+	boost::crc_32_type crc;
+	if(coversHeader) {
+		crc.process_bytes((const char*) &header + CHECKED_HEADER_OFFSET,
+			sizeof(header) - CHECKED_HEADER_OFFSET);
+	}
+	crc.process_bytes(data, header.length);
+	return crc.checksum();
+}
+
+bool CacheHelper::readEntry(string cacheFilename,
+		vector<char>& payload) const {
+	
+	ifstream ifs(cacheFilename, ios::binary);
+	if(!ifs) {
+		return false;
+	}
+	
+	ifs.seekg(0, ios::end);
+	uint64_t fileSize = ifs.tellg();
+	ifs.seekg(0, ios::beg);
+	
+	vector<char> stored(fileSize);
+	if(!ifs.read(stored.data(), fileSize)) {
+		return false;
+	}
+	
+	EntryHeader header;
+	size_t headerSize;
+	bool coversHeader = false;
+	if(fileSize >= sizeof(EntryHeader) &&
+			(memcmp(stored.data(), ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) == 0 ||
+			memcmp(stored.data(), ENTRY_MAGIC_V2, sizeof(ENTRY_MAGIC_V2)) == 0)) {
+		
+		memcpy(&header, stored.data(), sizeof(header));
+		headerSize = sizeof(header);
+		coversHeader = memcmp(header.magic, ENTRY_MAGIC,
+			sizeof(ENTRY_MAGIC)) == 0;
+	} else if(fileSize >= sizeof(EntryHeaderV1) &&
+			memcmp(stored.data(), ENTRY_MAGIC_V1, sizeof(ENTRY_MAGIC_V1)) == 0) {
+		
+		EntryHeaderV1 headerV1;
+		memcpy(&headerV1, stored.data(), sizeof(headerV1));
+		header.crc = headerV1.crc;
+		header.length = headerV1.length;
+		header.rawLength = headerV1.length;
+		header.codec = CacheCodec::NONE;
+		header.shuffleWidth = 1;
+		headerSize = sizeof(headerV1);
+	} else {
+		// The archive of older entries can only be checked by loading it
+		payload.swap(stored);
+		return true;
+	}
+	
+	const char* data = stored.data() + headerSize;
+	bool valid = header.length == fileSize - headerSize &&
+		getChecksum(header, data, coversHeader) == header.crc;
+	
+	// An entry compressed with a codec this build lacks is intact, it is
+	// only replaced when generated again
+	CacheCodec::Codec codec = static_cast<CacheCodec::Codec>(header.codec);
+	if(valid && !CacheCodec::isAvailable(codec)) {
+		return false;
+	}
+	
+	// The header of the older entries is not checked, so a damaged one can
+	// ask for any amount of memory
+	if(valid) {
+		try {
+			valid = CacheCodec::decode(data, header.length, codec,
+				header.shuffleWidth, header.rawLength, payload);
+		} catch(const exception&) {
+			valid = false;
+		}
+	}
+	
+	if(!valid) {
+		discardEntry(cacheFilename);
+	}
+	return valid;
+}
+
+void CacheHelper::writeEntry(string cacheFilename, const string& payload,
+		unsigned int shuffleWidth) const {
+	
+	boost::filesystem::path cachePath(cacheFilename);
+	boost::filesystem::create_directories(cachePath.parent_path());
+	
+	// Data the codec cannot shrink is stored as is, which is faster to read
+	CacheCodec::Codec codec = m_codec;
+	string compressed;
+	if(codec != CacheCodec::NONE) {
+		compressed = CacheCodec::encode(payload, codec, shuffleWidth);
+		if(compressed.size() >= payload.size()) {
+			codec = CacheCodec::NONE;
+			string().swap(compressed);
+		}
+	}
+	if(codec == CacheCodec::NONE) {
+		shuffleWidth = 1;
+	}
+	const string& stored = codec == CacheCodec::NONE ? payload : compressed;
+	
+	EntryHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+	header.length = stored.size();
+	header.rawLength = payload.size();
+	header.codec = codec;
+	header.shuffleWidth = shuffleWidth;
+	header.crc = getChecksum(header, stored.data(), true);
+	
+	// The name of the temporary file is unique to this writer, the rename
+	// replaces the entry at once
+	string tempFilename = cacheFilename + "." +
+		boost::filesystem::unique_path().string() + ".tmp";
+	bool written;
+	{
+		ofstream ofs(tempFilename, ios::binary);
+		ofs.write((const char*) &header, sizeof(header));
+		ofs.write(stored.data(), stored.size());
+		ofs.close();
+		written = !ofs.fail();
+	}
+	
+	// The cache is only an optimization, a failed write leaves the previous
+	// entry, if any, untouched
+	boost::system::error_code error;
+	if(written) {
+		boost::filesystem::rename(tempFilename, cacheFilename, error);
+	}
+	if(!written || error) {
+		boost::filesystem::remove(tempFilename, error);
+	}
+}
+
+void CacheHelper::discardEntry(string cacheFilename) const {
+	Profiler::increment(Profiler::CACHE_CORRUPT);
+	boost::system::error_code error;
+	boost::filesystem::remove(cacheFilename, error);
+}
+
+unsigned int CacheHelper::getShuffleWidth(const ImageFeatures* features) {
+	switch(features->getStorage()) {
+		case ImageFeatures::FLOAT16:
+			return 2;
+		case ImageFeatures::UINT8:
+			return 1;
+		default:
+			return sizeof(float);
+	}
+}
+
+void CacheHelper::touchEntry(string cacheFilename) const {
+	// The eviction only needs a rough order, so the time is updated at most
+	// once an hour to avoid a write on every hit
+	boost::system::error_code error;
+	time_t now = time(nullptr);
+	time_t modified = boost::filesystem::last_write_time(cacheFilename, error);
+	if(!error && now - modified > 3600) {
+		boost::filesystem::last_write_time(cacheFilename, now, error);
+	}
+}
+
+void CacheHelper::recordAccess(string cacheFolder, bool hit) const {
+	lock_guard<mutex> lock(m_usageMutex);
+	pair<uint64_t, uint64_t>& usage = m_usage[cacheFolder];
+	if(hit) {
+		usage.first++;
+	} else {
+		usage.second++;
+	}
+}
+
+void CacheHelper::purge(string filename) const {
+	if(!m_enabled) {
+		return;
+	}
+	
+	boost::filesystem::path basePath("cache/" + m_datasetPath);
+	if(!boost::filesystem::exists(basePath)) {
+		return;
+	}
+	
+	string cacheName = boost::replace_all_copy(filename, "/", "_");
+	for(boost::filesystem::directory_iterator it(basePath);
+			it != boost::filesystem::directory_iterator(); it++) {
+		
+		if(boost::filesystem::is_directory(it->path())) {
+			boost::filesystem::remove(it->path() / cacheName);
+		}
+	}
+}
+
+// The settings each type of data depends on, in the order they appear in
+// the cache folder names. Any setting which changes the data must be listed,
+// otherwise data generated with its other values would be reused.
+struct CacheKey {
+	const char* nodePath;
+	const char* defaultValue;
+};
+
+static const CacheKey FEATURE_KEYS[] = {
+	{"image.type", nullptr},
+	{"image.maxResolution", nullptr},
+	{"image.forceSize", nullptr},
+	{"image.smoothingSigma", nullptr},
+	{"features.type", nullptr},
+	{"features.gridSpacing", nullptr},
+	{"features.patchSize", nullptr},
+	{"features.multiScale", "false"},
+	{"features.layout", "Interleaved"},
+	{"features.lbpMapping", "Uniform"},
+	{"features.transforms", nullptr},
+	{"features.powerAlpha", "0.5"},
+	{"features.storage", "Float32"}
+};
+
+// Extractors whose descriptors changed since they were first cached. The
+// revision is added to the folder name, so the old entries are never loaded.
+// Some revisions only changed the multi-scale mode.
+struct DescriptorRevision {
+	const char* featureType;
+	const char* revision;
+	bool multiScaleOnly;
+};
+
+static const DescriptorRevision DESCRIPTOR_REVISIONS[] = {
+	{"HOG", "stacked", false},
+	{"SIFT", "smoothed", true}
+};
+
+static const CacheKey ENCODING_KEYS[] = {
+	{"codebook.type", nullptr},
+	{"codebook.textonImages", nullptr},
+	{"codebook.totalFeatures", nullptr},
+	{"codebook.pcaDimension", nullptr},
+	{"codebook.codewords", nullptr},
+	{"codebook.pcaWhitening", "false"},
+	{"histogram.type", nullptr},
+	{"histogram.pyramidLevels", nullptr},
+	{"framework.seed", "0"}
+};
+
+bool CacheHelper::isCacheKey(string nodePath) {
+	for(const CacheKey& key : FEATURE_KEYS) {
+		if(nodePath == key.nodePath) {
+			return true;
+		}
+	}
+	for(const CacheKey& key : ENCODING_KEYS) {
+		if(nodePath == key.nodePath) {
+			return true;
+		}
+	}
+	return false;
 }
 
 // Generate a cache path. This must be different for different settings in order
@@ -23,23 +331,26 @@ string CacheHelper::getCacheFolder(string filename,
 		return basePath + "/";
 	}
 	
-	stringstream cacheNameStream;
-	cacheNameStream	<< 
-		"_" << m_settings->get<string>("image.type") <<
-		"_" << m_settings->get<float>("image.smoothingSigma") << 
-		"_" << m_settings->get<string>("features.type") <<
-		"_" << m_settings->get<vector<int> >("features.gridSpacing")[0] <<
-		"_" << m_settings->get<vector<int> >("features.patchSize")[0];
+	string cacheName;
+	for(const CacheKey& key : FEATURE_KEYS) {
+		cacheName += "_" + m_settings->describe(key.nodePath, key.defaultValue);
+	}
+	string featureType = m_settings->get<string>("features.type");
+	bool multiScale = m_settings->get<bool>("features.multiScale", false);
+	for(const DescriptorRevision& revision : DESCRIPTOR_REVISIONS) {
+		if(featureType == revision.featureType &&
+				(multiScale || !revision.multiScaleOnly)) {
+			cacheName += string("_") + revision.revision;
+		}
+	}
 		
 	if(dataType == typeid(ImageFeatures)) {
-		return basePath + cacheNameStream.str() + "/";
+		return basePath + cacheName + "/";
 	}
 	
-	cacheNameStream	<<
-		"_" << m_settings->get<int>("codebook.textonImages") <<
-		"_" << m_settings->get<int>("codebook.codewords") <<
-		"_" << m_settings->get<string>("histogram.type") <<
-		"_" << m_settings->get<int>("histogram.pyramidLevels");
+	for(const CacheKey& key : ENCODING_KEYS) {
+		cacheName += "_" + m_settings->describe(key.nodePath, key.defaultValue);
+	}
 	
-	return basePath + cacheNameStream.str() + "/";
+	return basePath + cacheName + "/";
 }
@@ -3,16 +3,32 @@
 
 #include <cctype>
 #include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <streambuf>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
 
 #include <boost/range/algorithm/remove_if.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/crc.hpp>
 
 #include "framework/SettingsManager.h"
 #include "features/ImageFeatures.h"
+#include "codebook/Histogram.h"
 #include "utils/DatasetManager.h"
+#include "utils/CacheCodec.h"
+#include "utils/CacheManager.h"
+#include "utils/OutputHelper.h"
+#include "utils/Profiler.h"
 
 
 /**
@@ -20,6 +36,21 @@
  *
  * Provides utilities for loading and saving data, creating a unique cache
  * name based on the requested file and the classification parameters.
+ *
+ * Each entry is written to a temporary file which is then renamed over the
+ * final one, so neither a crash nor several threads or processes writing
+ * the same entry can leave a partial file behind. The archive is preceded by
+ * a header with its length and compression, and a CRC-32 of both. Entries
+ * which do not match it when loaded are deleted and reported as missing, to
+ * be generated again.
+ *
+ * The archives can be compressed with one of the codecs of @a CacheCodec,
+ * chosen by the @a framework.cacheCompression setting. The codec is recorded
+ * in each entry, so entries written with other settings are still read.
+ *
+ * The hits and misses of each folder are recorded with @a CacheManager when
+ * the instance is destroyed, and loading an entry marks it as recently used
+ * for the eviction of the cache.
  */
 class CacheHelper {
 public:
@@ -33,6 +64,11 @@ public:
 	 */
 	CacheHelper(std::string datasetPath, const SettingsManager* settings);
 	
+	/**
+	 * @brief Records the hits and misses of the loaded data.
+	 */
+	~CacheHelper();
+	
 	/**
 	 * @brief Load the data from the hard drive.
 	 *
@@ -48,15 +84,30 @@ public:
 			return nullptr;
 		}
 			
-		std::string cacheFilename = getCacheFolder(filename, typeid(T)) +
-			boost::replace_all_copy(filename, "/", "_");
+		std::string cacheFolder = getCacheFolder(filename, typeid(T));
+		std::string cacheFilename =
+			cacheFolder + boost::replace_all_copy(filename, "/", "_");
 		
+		Profiler::Timer timer(Profiler::CACHE_READ);
 		T* data = nullptr;
-		if(boost::filesystem::exists(cacheFilename)) {
-			std::ifstream ifs(cacheFilename);
-			boost::archive::binary_iarchive ia(ifs);
-			ia >> data;
+		std::vector<char> payload;
+		if(readEntry(cacheFilename, payload)) {
+			try {
+				MemoryBuffer buffer(payload);
+				std::istream is(&buffer);
+				boost::archive::binary_iarchive ia(is);
+				ia >> data;
+			} catch(...) {
+				data = nullptr;
+				discardEntry(cacheFilename);
+			}
 		}
+		if(data != nullptr) {
+			touchEntry(cacheFilename);
+		}
+		recordAccess(cacheFolder, data != nullptr);
+		Profiler::increment(data == nullptr ?
+			Profiler::CACHE_MISSES : Profiler::CACHE_HITS);
 		return data;
 	}
 	
@@ -75,26 +126,147 @@ public:
 			return;
 		}
 		
-		std::string cacheFolder = getCacheFolder(filename, typeid(T));
-		std::string cacheFilename = cacheFolder +
-			boost::replace_all_copy(filename, "/", "_");
+		Profiler::Timer timer(Profiler::CACHE_WRITE);
+		std::ostringstream oss;
+		{
+			boost::archive::binary_oarchive oa(oss);
+			oa << data;
+		}
+		writeEntry(getCacheFilename(filename, typeid(T)), oss.str(),
+			m_shuffle ? getShuffleWidth(data) : 1);
+	}
+	
+	/**
+	 * @brief Remove the data from the hard drive.
+	 *
+	 * Only the data saved with the current settings is removed.
+	 *
+	 * @param filename Name that uniquely identifies the data to be removed.
+	 */
+	template <typename T> void remove(std::string filename) const {
+		if(!m_enabled) {
+			return;
+		}
 		
-		if(!boost::filesystem::exists(cacheFolder)) {
-			boost::filesystem::create_directories(cacheFolder);
+		boost::filesystem::remove(getCacheFilename(filename, typeid(T)));
+	}
+	
+	/**
+	 * @brief Remove all the data of a type from the hard drive.
+	 *
+	 * Only the data saved with the current settings is removed.
+	 */
+	template <typename T> void clear() const {
+		if(!m_enabled) {
+			return;
 		}
+		
+		boost::filesystem::remove_all(getCacheFolder("", typeid(T)));
+	}
+	
+	/**
+	 * @brief Remove the data of a file from the whole cache of the dataset.
+	 *
+	 * Every type of data saved under this name is removed, whatever the
+	 * settings used to generate it. This is used when the file it was
+	 * derived from changes.
+	 *
+	 * @param filename Name that uniquely identifies the data to be removed.
+	 */
+	void purge(std::string filename) const;
+	
+	/**
+	 * @brief Provides the folder holding the shards of a type of data.
+	 *
+	 * @see ShardStore
+	 *
+	 * @return The path of the folder, which belongs to the cache of the
+	 * current settings.
+	 */
+	template <typename T> std::string getShardFolder() const {
+		return getCacheFolder("", typeid(T)) + "shards/";
+	}
+	
+	/**
+	 * @brief Provides the path of data stored in its own format.
+	 *
+	 * This is used for data which is read in place instead of being
+	 * deserialized, such as a @a TrainingMatrix. The file is marked as
+	 * recently used, since it is about to be read.
+	 *
+	 * @param filename Name that uniquely identifies the data.
+	 * @return The path of the file, which belongs to the cache of the
+	 * current settings.
+	 */
+	template <typename T> std::string getFilePath(std::string filename) const {
+		std::string cacheFilename = getCacheFilename(filename, typeid(T));
+		touchEntry(cacheFilename);
+		return cacheFilename;
+	}
+	
+	/**
+	 * @brief Checks whether a setting is part of the cache folder names.
+	 *
+	 * Data generated with different values of these settings is kept
+	 * apart. The other settings must not change the cached data.
+	 *
+	 * @param nodePath The path of the setting, such as @a features.type.
+	 * @return @a true if the setting is part of the folder names.
+	 */
+	static bool isCacheKey(std::string nodePath);
 	
-		std::ofstream ofs(cacheFilename);
-		boost::archive::binary_oarchive oa(ofs);
-		oa << data;
+	/**
+	 * @brief Checks whether the data is saved at all.
+	 *
+	 * @return The value of the @a framework.cacheData setting.
+	 */
+	bool isEnabled() const {
+		return m_enabled;
 	}
 
 private:
+	// Reads an archive kept in memory without copying it
+	struct MemoryBuffer : public std::streambuf {
+		MemoryBuffer(std::vector<char>& data) {
+			setg(data.data(), data.data(), data.data() + data.size());
+		}
+	};
+	
 	bool m_enabled;
+	CacheCodec::Codec m_codec;
+	bool m_shuffle;
 	std::string m_datasetPath;
 	const SettingsManager* m_settings;
 	
+	// The hits and misses of each folder
+	mutable std::map<std::string, std::pair<uint64_t, uint64_t> > m_usage;
+	mutable std::mutex m_usageMutex;
+	
 	std::string getCacheFolder(std::string filename, 
 		const std::type_info& dataType) const;
+	bool readEntry(std::string cacheFilename,
+		std::vector<char>& payload) const;
+	void writeEntry(std::string cacheFilename, const std::string& payload,
+		unsigned int shuffleWidth) const;
+	void discardEntry(std::string cacheFilename) const;
+	void touchEntry(std::string cacheFilename) const;
+	void recordAccess(std::string cacheFolder, bool hit) const;
+	
+	// The size of the numbers making up most of the archive, whose bytes are
+	// shuffled before compressing it
+	static unsigned int getShuffleWidth(const ImageFeatures* features);
+	static unsigned int getShuffleWidth(const Histogram* histogram) {
+		return sizeof(double);
+	}
+	template <typename T> static unsigned int getShuffleWidth(const T* data) {
+		return 1;
+	}
+	
+	std::string getCacheFilename(std::string filename,
+		const std::type_info& dataType) const {
+		return getCacheFolder(filename, dataType) +
+			boost::replace_all_copy(filename, "/", "_");
+	}
 };
 
 #endif
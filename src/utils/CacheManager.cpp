@@ -0,0 +1,153 @@
+#include "CacheManager.h"
+using namespace std;
+using namespace boost::filesystem;
+
+// Holds one line of hits and misses per run, ignored by the eviction
+static const char* USAGE_FILENAME = ".usage";
+
+// The folders holding a codebook and the histograms encoded with it, which
+// share the same settings after the name of the type
+static const char* ENCODING_FOLDERS[] = {"Codebook", "Histogram"};
+
+CacheManager::CacheManager(string cachePath) {
+	m_cachePath = cachePath;
+}
+
+vector<CacheManager::Usage> CacheManager::getUsage() const {
+	vector<Entry> entries;
+	scanFolder(m_cachePath, entries);
+
+	map<string, Usage> folders;
+	for(unsigned int i = 0; i < entries.size(); i++) {
+		path folder = entries[i].path.parent_path();
+		string folderName = folder.string();
+		if(folders.find(folderName) == folders.end()) {
+			Usage usage = {folderName, 0, 0, 0, 0};
+			folders[folderName] = usage;
+		}
+		if(entries[i].path.filename() == USAGE_FILENAME) {
+			std::ifstream ifs(entries[i].path.string());
+			uint64_t hits, misses;
+			while(ifs >> hits >> misses) {
+				folders[folderName].hits += hits;
+				folders[folderName].misses += misses;
+			}
+		} else {
+			folders[folderName].bytes += entries[i].size;
+			folders[folderName].entries++;
+		}
+	}
+
+	vector<Usage> usage;
+	for(map<string, Usage>::iterator it = folders.begin();
+			it != folders.end(); it++) {
+		usage.push_back(it->second);
+	}
+	return usage;
+}
+
+uintmax_t CacheManager::evict(uintmax_t budget) const {
+	vector<Entry> entries;
+	scanFolder(m_cachePath, entries);
+
+	uintmax_t total = 0;
+	map<string, Unit> units;
+	for(unsigned int i = 0; i < entries.size(); i++) {
+		total += entries[i].size;
+		if(isProtected(entries[i].path.parent_path()) ||
+				entries[i].path.filename() == USAGE_FILENAME) {
+			continue;
+		}
+
+		string unitName = getUnitName(entries[i].path);
+		if(units.find(unitName) == units.end()) {
+			Unit unit = {vector<path>(), 0, entries[i].time};
+			units[unitName] = unit;
+		}
+		Unit& unit = units[unitName];
+		unit.paths.push_back(entries[i].path);
+		unit.size += entries[i].size;
+		unit.time = max(unit.time, entries[i].time);
+	}
+	if(total <= budget) {
+		return 0;
+	}
+
+	vector<Unit> sortedUnits;
+	for(map<string, Unit>::iterator it = units.begin();
+			it != units.end(); it++) {
+		sortedUnits.push_back(it->second);
+	}
+	sort(sortedUnits.begin(), sortedUnits.end(),
+		[](const Unit& a, const Unit& b) {
+			return a.time < b.time;
+		});
+
+	uintmax_t removed = 0;
+	for(unsigned int i = 0; i < sortedUnits.size() && total > budget; i++) {
+		for(unsigned int j = 0; j < sortedUnits[i].paths.size(); j++) {
+			boost::system::error_code error;
+			uintmax_t size = file_size(sortedUnits[i].paths[j], error);
+			if(!error && remove(sortedUnits[i].paths[j], error)) {
+				total -= size;
+				removed += size;
+			}
+		}
+	}
+	return removed;
+}
+
+void CacheManager::recordUsage(string folder, uint64_t hits,
+		uint64_t misses) {
+
+	// Each line is written at once, so the processes sharing the cache can
+	// append to the same file
+	boost::system::error_code error;
+	create_directories(folder, error);
+	std::ofstream ofs((path(folder) / USAGE_FILENAME).string(), ios::app);
+	ofs << to_string(hits) + " " + to_string(misses) + "\n" << flush;
+}
+
+void CacheManager::scanFolder(const path& folder,
+		vector<Entry>& entries) const {
+
+	boost::system::error_code error;
+	for(directory_iterator it(folder, error);
+			!error && it != directory_iterator(); it.increment(error)) {
+
+		if(is_directory(it->path(), error)) {
+			scanFolder(it->path(), entries);
+			continue;
+		}
+
+		Entry entry;
+		entry.path = it->path();
+		entry.size = file_size(entry.path, error);
+		entry.time = last_write_time(entry.path, error);
+		if(!error) {
+			entries.push_back(entry);
+		}
+		error.clear();
+	}
+}
+
+bool CacheManager::isProtected(const path& folder) const {
+	return folder.filename() == "shards" ||
+		folder.filename() == "DatasetManager";
+}
+
+string CacheManager::getUnitName(const path& entryPath) const {
+	path folder = entryPath.parent_path();
+	string folderName = folder.filename().string();
+	size_t separator = folderName.find('_');
+	if(separator != string::npos) {
+		string typeName = folderName.substr(0, separator);
+		for(const char* encodingFolder : ENCODING_FOLDERS) {
+			if(typeName == encodingFolder) {
+				return (folder.parent_path() /
+					folderName.substr(separator)).string();
+			}
+		}
+	}
+	return entryPath.string();
+}
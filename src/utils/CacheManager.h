@@ -0,0 +1,105 @@
+#ifndef CACHE_MANAGER_H
+#define CACHE_MANAGER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+
+#include <boost/filesystem.hpp>
+
+/**
+ * @brief Keeps the cache folder within a size budget.
+ *
+ * Every combination of settings creates its own folders in the cache, which
+ * would otherwise grow without limit. The entries which were used the
+ * longest time ago are removed first, whatever their type or settings. The
+ * time of an entry is the modification time of its file, which
+ * @a CacheHelper updates when the entry is loaded.
+ *
+ * A codebook is removed together with the histograms and the training matrix
+ * encoded with it, once none of them was used for the longest time. The
+ * histograms would not match a codebook generated again, so they are never
+ * kept without their own.
+ *
+ * The dataset splits and the shards waiting to be merged are never removed,
+ * since they cannot be generated again from the images alone.
+ *
+ * The hits and misses of each folder are appended by every process to a
+ * small file inside it, so the usage of each combination of settings can be
+ * reported across runs.
+ */
+class CacheManager {
+public:
+	/**
+	 * @brief The usage of one folder of the cache.
+	 */
+	struct Usage {
+		std::string folder;   /**< path of the folder in the cache */
+		uintmax_t bytes;      /**< total size of its entries */
+		unsigned int entries; /**< number of entries */
+		uint64_t hits;        /**< entries found when loading */
+		uint64_t misses;      /**< entries missing when loading */
+	};
+
+	/**
+	 * @brief Manages the cache in a given folder.
+	 *
+	 * @param cachePath The root folder of the cache.
+	 */
+	CacheManager(std::string cachePath = "cache");
+
+	/**
+	 * @brief Lists the usage of every folder holding entries.
+	 *
+	 * @return The usage of each folder, sorted by path.
+	 */
+	std::vector<Usage> getUsage() const;
+
+	/**
+	 * @brief Removes the least recently used entries over the budget.
+	 *
+	 * Errors, such as entries removed by another process at the same time,
+	 * are ignored.
+	 *
+	 * @param budget The maximum size of the cache in bytes.
+	 * @return The number of bytes removed.
+	 */
+	uintmax_t evict(uintmax_t budget) const;
+
+	/**
+	 * @brief Adds the hits and misses of a run to the usage of a folder.
+	 *
+	 * @param folder The folder of the cache the entries were loaded from.
+	 * @param hits The number of entries found.
+	 * @param misses The number of entries missing.
+	 */
+	static void recordUsage(std::string folder, uint64_t hits,
+		uint64_t misses);
+
+private:
+	struct Entry {
+		boost::filesystem::path path;
+		uintmax_t size;
+		std::time_t time;
+	};
+
+	// Entries removed together, last used at the time of the newest one
+	struct Unit {
+		std::vector<boost::filesystem::path> paths;
+		uintmax_t size;
+		std::time_t time;
+	};
+
+	std::string m_cachePath;
+
+	void scanFolder(const boost::filesystem::path& folder,
+		std::vector<Entry>& entries) const;
+	bool isProtected(const boost::filesystem::path& folder) const;
+	std::string getUnitName(const boost::filesystem::path& entryPath) const;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef CACHE_PREFETCHER_H
+#define CACHE_PREFETCHER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#include "utils/CacheHelper.h"
+
+/**
+ * @brief Loads cached data ahead of the threads processing it.
+ *
+ * A few dedicated threads read and deserialize the entries of a list of
+ * files, in order, while the workers process the entries loaded before them.
+ * The workers get each entry with take(), so when the data is cached they
+ * only wait for the disk if the readers fall behind.
+ *
+ * The workers should go through the list roughly in order, such as with a
+ * dynamic OpenMP schedule. An entry the readers have not started yet is
+ * loaded by the worker asking for it, instead of waiting for them. At most a
+ * fixed number of entries are loaded and not yet taken, which bounds the
+ * memory used when the workers are slower than the disk.
+ */
+template <typename T> class CachePrefetcher {
+public:
+	/**
+	 * @brief Starts loading the entries of a list of files.
+	 *
+	 * @param cacheHelper The cache the entries are loaded from.
+	 * @param filenames The names of the entries, in the order they will most
+	 * likely be taken.
+	 * @param numThreads The number of threads loading the entries. With no
+	 * threads, each entry is loaded by the worker taking it.
+	 * @param window The maximum number of entries loaded ahead.
+	 */
+	CachePrefetcher(const CacheHelper* cacheHelper,
+			const std::vector<std::string>& filenames, unsigned int numThreads,
+			unsigned int window) :
+			m_states(filenames.size(), PENDING),
+			m_data(filenames.size(), nullptr) {
+
+		m_cacheHelper = cacheHelper;
+		m_filenames = filenames;
+		m_window = std::max(window, 1u);
+		m_next = 0;
+		m_numAhead = 0;
+		m_stopped = false;
+
+		numThreads = std::min<size_t>(numThreads, filenames.size());
+		for(unsigned int i = 0; i < numThreads; i++) {
+			m_threads.push_back(std::thread(&CachePrefetcher::run, this));
+		}
+	}
+
+	/**
+	 * @brief Stops loading and releases the entries which were not taken.
+	 */
+	~CachePrefetcher() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopped = true;
+		}
+		m_spaceAvailable.notify_all();
+		for(unsigned int i = 0; i < m_threads.size(); i++) {
+			m_threads[i].join();
+		}
+
+		for(unsigned int i = 0; i < m_data.size(); i++) {
+			delete m_data[i];
+		}
+	}
+
+	/**
+	 * @brief Provides the entry of a file, waiting for it if needed.
+	 *
+	 * Each entry can only be taken once.
+	 *
+	 * @param index The position of the file in the list.
+	 * @return The data, to be deleted by the caller, or @a nullptr if it is
+	 * not cached.
+	 */
+	T* take(unsigned int index) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if(m_states[index] == PENDING) {
+			m_states[index] = TAKEN;
+			lock.unlock();
+			return m_cacheHelper->load<T>(m_filenames[index]);
+		}
+
+		m_entryLoaded.wait(lock, [&]() {
+			return m_states[index] != LOADING;
+		});
+		T* data = m_data[index];
+		m_data[index] = nullptr;
+		m_states[index] = TAKEN;
+		m_numAhead--;
+		m_spaceAvailable.notify_one();
+		return data;
+	}
+
+private:
+	enum State {
+		PENDING,
+		LOADING,
+		LOADED,
+		TAKEN
+	};
+
+	const CacheHelper* m_cacheHelper;
+	std::vector<std::string> m_filenames;
+	unsigned int m_window;
+
+	std::vector<State> m_states;
+	std::vector<T*> m_data;
+	unsigned int m_next;
+	unsigned int m_numAhead;
+	bool m_stopped;
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_entryLoaded;
+	std::condition_variable m_spaceAvailable;
+
+	void run() {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while(true) {
+			m_spaceAvailable.wait(lock, [&]() {
+				return m_stopped || m_numAhead < m_window;
+			});
+			while(m_next < m_states.size() && m_states[m_next] != PENDING) {
+				m_next++;
+			}
+			if(m_stopped || m_next == m_states.size()) {
+				return;
+			}
+
+			unsigned int index = m_next++;
+			m_states[index] = LOADING;
+			m_numAhead++;
+			lock.unlock();
+
+			// A failed read is left for the worker to generate, like a miss
+			T* data = nullptr;
+			try {
+				data = m_cacheHelper->load<T>(m_filenames[index]);
+			} catch(...) {
+			}
+
+			lock.lock();
+			m_data[index] = data;
+			m_states[index] = LOADED;
+			m_entryLoaded.notify_all();
+		}
+	}
+};
+
+#endif
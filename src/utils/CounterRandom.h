@@ -0,0 +1,74 @@
+#ifndef COUNTER_RANDOM_H
+#define COUNTER_RANDOM_H
+
+#include <cstdint>
+
+/**
+ * @brief Seeded random number generator without any mutable state.
+ *
+ * Each number is a hash of the seed, the stream and a counter, so the n-th
+ * number can be computed directly. Any number of threads can share the same
+ * generator and the results only depend on which counters are used, never on
+ * the order or the thread they are computed on. This keeps every random
+ * choice reproducible across runs, builds and numbers of threads.
+ *
+ * The hash is the SplitMix64 finalizer, which is fast and has good enough
+ * statistical quality for sampling and shuffling.
+ */
+class CounterRandom {
+public:
+	/**
+	 * @brief The independent streams of numbers used by the framework.
+	 *
+	 * Using a different stream for each purpose prevents two unrelated
+	 * choices made with the same seed from being correlated.
+	 */
+	enum Stream {
+		DATASET_SPLIT,       /**< shuffling the dataset before splitting it */
+		DESCRIPTOR_SAMPLING, /**< choosing the descriptors of a codebook */
+		CLUSTERING,          /**< initializing the clustering of a codebook */
+		SOLVER_SHUFFLE       /**< seeding the shuffles of the linear solvers */
+	};
+
+	/**
+	 * @brief Initializes the generator.
+	 *
+	 * @param seed The seed chosen by the user.
+	 * @param stream The stream of numbers to be generated.
+	 */
+	CounterRandom(uint64_t seed, Stream stream) {
+		m_key = mix(seed ^ mix(stream + 1));
+	}
+
+	/**
+	 * @brief Generates the number at a given position of the stream.
+	 *
+	 * @param counter The position of the number.
+	 * @return A uniformly distributed 64 bit number.
+	 */
+	uint64_t operator()(uint64_t counter) const {
+		return mix(m_key + (counter + 1) * 0x9e3779b97f4a7c15ull);
+	}
+
+	/**
+	 * @brief Generates an index at a given position of the stream.
+	 *
+	 * @param counter The position of the number.
+	 * @param size The number of possible indices.
+	 * @return A number between 0 and @a size - 1.
+	 */
+	uint64_t index(uint64_t counter, uint64_t size) const {
+		return (*this)(counter) % size;
+	}
+
+private:
+	uint64_t m_key;
+
+	static uint64_t mix(uint64_t value) {
+		value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+		value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+		return value ^ (value >> 31);
+	}
+};
+
+#endif
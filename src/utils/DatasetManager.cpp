@@ -3,73 +3,270 @@ using namespace std;
 using namespace boost::filesystem;
 
 DatasetManager::DatasetManager() {
+	m_seed = 0;
+	m_trainImagesPerClass = 0;
 }
 
 DatasetManager::DatasetManager(std::string datasetPath,
-		unsigned int trainImagesPerClass) {
-		
+		unsigned int trainImagesPerClass, uint64_t seed) {
+
 	m_datasetPath = datasetPath;
-	
+	m_seed = seed;
+	m_trainImagesPerClass = trainImagesPerClass;
+
 	preloadFileLists();
-	
-	unsigned seed = chrono::system_clock::now().time_since_epoch().count();
-	shuffle(m_classFiles.begin(), m_classFiles.end(),
-		default_random_engine(seed));
-	sort(m_classNames.begin(), m_classNames.end());
-	
+
+	vector<uint32_t> files = shuffleFiles();
 	vector<unsigned int> classTotal(m_classNames.size(), 0);
-	for(unsigned int i = 0; i < m_classFiles.size(); i++) {
-		unsigned int classNumber = distance(m_classNames.begin(),
-			find(m_classNames.begin(), m_classNames.end(),
-			m_classFiles[i].second));
-			
+	for(unsigned int i = 0; i < files.size(); i++) {
+		unsigned int classNumber = m_fileClasses[files[i]];
 		if(classTotal[classNumber] < trainImagesPerClass) {
-			m_trainFiles.push_back(m_classFiles[i].first);
-			m_trainClasses.push_back(classNumber);
+			m_trainFiles.push_back(files[i]);
 			classTotal[classNumber]++;
 		} else {
-			m_testFiles.push_back(m_classFiles[i].first);
-			m_testClasses.push_back(classNumber);
+			m_testFiles.push_back(files[i]);
+		}
+	}
+}
+
+vector<uint32_t> DatasetManager::shuffleFiles() const {
+	vector<uint32_t> files(m_fileClasses.size());
+	for(unsigned int i = 0; i < files.size(); i++) {
+		files[i] = i;
+	}
+
+	// Fisher-Yates shuffle, written out since the result of std::shuffle
+	// differs between standard libraries
+	CounterRandom random(m_seed, CounterRandom::DATASET_SPLIT);
+	for(unsigned int i = files.size(); i > 1; i--) {
+		swap(files[i - 1], files[random.index(i, i)]);
+	}
+	return files;
+}
+
+void DatasetManager::setFold(unsigned int fold, unsigned int numFolds) {
+	if(numFolds < 2 || fold >= numFolds) {
+		throw invalid_argument("Invalid fold " + to_string(fold) + " of " +
+			to_string(numFolds));
+	}
+
+	m_trainFiles.clear();
+	m_testFiles.clear();
+
+	vector<uint32_t> files = shuffleFiles();
+	vector<unsigned int> classTotal(m_classNames.size(), 0);
+	for(unsigned int i = 0; i < files.size(); i++) {
+		unsigned int classNumber = m_fileClasses[files[i]];
+		if(classTotal[classNumber] % numFolds == fold) {
+			m_testFiles.push_back(files[i]);
+		} else {
+			m_trainFiles.push_back(files[i]);
 		}
+		classTotal[classNumber]++;
 	}
 }
 
+DatasetManager::Changes DatasetManager::refresh() {
+	vector<string> classNames;
+	vector<vector<FileInfo> > classFiles;
+	scanFolders(classNames, classFiles);
+
+	unordered_map<string, uint32_t> oldFiles;
+	for(uint32_t i = 0; i < m_fileClasses.size(); i++) {
+		oldFiles[getFilePath(i)] = i;
+	}
+
+	// Index the files found again from scratch, remembering where each of
+	// the known files ended up
+	DatasetManager updated;
+	updated.m_datasetPath = m_datasetPath;
+	updated.m_seed = m_seed;
+	updated.m_trainImagesPerClass = m_trainImagesPerClass;
+	updated.m_classNames = classNames;
+	for(unsigned int i = 0; i < classNames.size(); i++) {
+		updated.m_classDirs.push_back(getClassDir(classNames[i]));
+	}
+
+	Changes changes;
+	vector<int64_t> newIndices(m_fileClasses.size(), -1);
+	vector<uint32_t> addedFiles;
+	for(unsigned int i = 0; i < classFiles.size(); i++) {
+		for(unsigned int j = 0; j < classFiles[i].size(); j++) {
+			uint32_t newIndex = updated.m_fileClasses.size();
+			updated.addFile(classFiles[i][j], i);
+
+			string filePath = updated.getFilePath(newIndex);
+			unordered_map<string, uint32_t>::iterator it =
+				oldFiles.find(filePath);
+			if(it == oldFiles.end()) {
+				changes.added.push_back(filePath);
+				addedFiles.push_back(newIndex);
+				continue;
+			}
+
+			uint32_t oldIndex = it->second;
+			newIndices[oldIndex] = newIndex;
+			if(m_fileSizes[oldIndex] != classFiles[i][j].size ||
+					m_fileTimes[oldIndex] != classFiles[i][j].time) {
+
+				changes.modified.push_back(filePath);
+			}
+		}
+		vector<FileInfo>().swap(classFiles[i]);
+	}
+
+	for(uint32_t i = 0; i < m_fileClasses.size(); i++) {
+		if(newIndices[i] < 0) {
+			changes.removed.push_back(getFilePath(i));
+		}
+	}
+
+	// The known files keep their set and their shuffled order
+	vector<unsigned int> classTotal(classNames.size(), 0);
+	for(unsigned int i = 0; i < m_trainFiles.size(); i++) {
+		if(newIndices[m_trainFiles[i]] >= 0) {
+			uint32_t file = newIndices[m_trainFiles[i]];
+			updated.m_trainFiles.push_back(file);
+			classTotal[updated.m_fileClasses[file]]++;
+		}
+	}
+	for(unsigned int i = 0; i < m_testFiles.size(); i++) {
+		if(newIndices[m_testFiles[i]] >= 0) {
+			updated.m_testFiles.push_back(newIndices[m_testFiles[i]]);
+		}
+	}
+
+	// The new files are shuffled further along the stream of the split, so
+	// they do not repeat the choices made for the known files
+	CounterRandom random(m_seed, CounterRandom::DATASET_SPLIT);
+	uint64_t counterBase = m_fileClasses.size() + 1;
+	for(unsigned int i = addedFiles.size(); i > 1; i--) {
+		swap(addedFiles[i - 1],
+			addedFiles[random.index(counterBase + i, i)]);
+	}
+	for(unsigned int i = 0; i < addedFiles.size(); i++) {
+		unsigned int classNumber = updated.m_fileClasses[addedFiles[i]];
+		if(classTotal[classNumber] < m_trainImagesPerClass) {
+			updated.m_trainFiles.push_back(addedFiles[i]);
+			classTotal[classNumber]++;
+		} else {
+			updated.m_testFiles.push_back(addedFiles[i]);
+		}
+	}
+
+	*this = updated;
+	return changes;
+}
+
+string DatasetManager::getClassDir(string className) const {
+	return (path(m_datasetPath) / className).relative_path().string();
+}
+
+string DatasetManager::getFilePath(uint32_t file) const {
+	uint32_t start = file == 0 ? 0 : m_fileNameEnds[file - 1];
+	return m_classDirs[m_fileClasses[file]] + "/" +
+		m_fileNames.substr(start, m_fileNameEnds[file] - start);
+}
+
 void DatasetManager::preloadFileLists() {
-	path baseDir(m_datasetPath);
-	for(directory_iterator it(baseDir); it != directory_iterator(); it++) {
-		string className = it->path().filename().string();
-		m_classNames.push_back(className);
-		preloadClassFileList(className, it->path().relative_path());
+	vector<vector<FileInfo> > classFiles;
+	scanFolders(m_classNames, classFiles);
+
+	for(unsigned int i = 0; i < m_classNames.size(); i++) {
+		m_classDirs.push_back(getClassDir(m_classNames[i]));
+	}
+
+	for(unsigned int i = 0; i < classFiles.size(); i++) {
+		for(unsigned int j = 0; j < classFiles[i].size(); j++) {
+			addFile(classFiles[i][j], i);
+		}
+		vector<FileInfo>().swap(classFiles[i]);
 	}
 }
 
-void DatasetManager::preloadClassFileList(string className, path classDir) {
-	for(directory_iterator it(classDir); it != directory_iterator(); it++) {
-		string fileName = it->path().relative_path().string();
-		
-		m_classFiles.push_back(make_pair(fileName, className));
+void DatasetManager::scanFolders(vector<string>& classNames,
+		vector<vector<FileInfo> >& classFiles) const {
+
+	classNames.clear();
+	for(directory_iterator it(m_datasetPath); it != directory_iterator();
+			it++) {
+
+		if(is_directory(it->path())) {
+			classNames.push_back(it->path().filename().string());
+		}
+	}
+	sort(classNames.begin(), classNames.end());
+
+	if(classNames.size() > UINT16_MAX) {
+		throw length_error("Too many classes in " + m_datasetPath);
+	}
+
+	// Each class is listed by a different thread, the first error found is
+	// thrown once all of them finish
+	classFiles.assign(classNames.size(), vector<FileInfo>());
+	exception_ptr error;
+	#pragma omp parallel for schedule(dynamic)
+	for(unsigned int i = 0; i < classNames.size(); i++) {
+		try {
+			for(directory_iterator it(getClassDir(classNames[i]));
+					it != directory_iterator(); it++) {
+
+				if(!is_regular_file(it->path())) {
+					continue;
+				}
+				FileInfo file;
+				file.name = it->path().filename().string();
+				file.size = file_size(it->path());
+				file.time = last_write_time(it->path());
+				classFiles[i].push_back(file);
+			}
+			sort(classFiles[i].begin(), classFiles[i].end(),
+				[](const FileInfo& a, const FileInfo& b) {
+					return a.name < b.name;
+				});
+		} catch(...) {
+			#pragma omp critical
+			if(!error) {
+				error = current_exception();
+			}
+		}
+	}
+
+	if(error) {
+		rethrow_exception(error);
 	}
 }
 
-vector<string> DatasetManager::listFiles() const {
-	vector<string> results;
+void DatasetManager::addFile(string fileName, unsigned int classIndex) {
+	if(m_fileNames.size() + fileName.size() > UINT32_MAX) {
+		throw length_error("Too many files in " + m_datasetPath);
+	}
+
+	m_fileNames += fileName;
+	m_fileNameEnds.push_back(m_fileNames.size());
+	m_fileClasses.push_back(classIndex);
+}
 
-	pair<string, string> data;
-	BOOST_FOREACH(data, m_classFiles) {
-		results.push_back(data.first);
+void DatasetManager::addFile(const FileInfo& file, unsigned int classIndex) {
+	addFile(file.name, classIndex);
+	m_fileSizes.push_back(file.size);
+	m_fileTimes.push_back(file.time);
+}
+
+vector<string> DatasetManager::listImagePaths(Split split) const {
+	vector<string> results;
+	results.reserve(getNumImages(split));
+	for(unsigned int i = 0; i < getNumImages(split); i++) {
+		results.push_back(getImagePath(split, i));
 	}
-	
 	return results;
 }
 
-vector<unsigned int> DatasetManager::getImageClasses() const {
+vector<unsigned int> DatasetManager::listImageClasses(Split split) const {
 	vector<unsigned int> results;
-
-	pair<string, string> data;
-	BOOST_FOREACH(data, m_classFiles) {
-		results.push_back(distance(m_classNames.begin(),
-			find(m_classNames.begin(), m_classNames.end(), data.second)));
+	results.reserve(getNumImages(split));
+	for(unsigned int i = 0; i < getNumImages(split); i++) {
+		results.push_back(getImageClass(split, i));
 	}
-	
 	return results;
 }
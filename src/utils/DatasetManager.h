@@ -6,13 +6,18 @@
 #include <utility>
 #include <algorithm>
 #include <map>
-#include <random>
-#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <unordered_map>
 
-#include <boost/foreach.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/utility.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/version.hpp>
+
+#include "utils/CounterRandom.h"
 
 /**
  * @brief Hold the information about the dataset.
@@ -20,23 +25,66 @@
  * The class will index the files in a folder as well as associating them with
  * their class label. These files will also be split among two sets,
  * corresponding to the training data and the test data.
+ *
+ * To keep large datasets small, both in memory and in the cache, each file
+ * only stores its name and the index of its class. The names are packed into
+ * a single string and the paths are built when requested. The train and test
+ * sets only hold indices to those files and can be iterated with
+ * getImagePath() and getImageClass() without building any list of strings.
+ *
+ * The size and modification time of each file are recorded as well, so a
+ * cached dataset can be compared against the folder with refresh().
  */
 class DatasetManager {
 public:
+	/**
+	 * @brief The sets the dataset is split into.
+	 */
+	enum Split {
+		TRAIN, /**< images used to train the classifier */
+		TEST   /**< images used to test the classifier */
+	};
+	
+	/**
+	 * @brief The files which changed since the dataset was indexed.
+	 */
+	struct Changes {
+		std::vector<std::string> added;    /**< new files */
+		std::vector<std::string> modified; /**< files with a new size or time */
+		std::vector<std::string> removed;  /**< files no longer present */
+		
+		bool empty() const {
+			return added.empty() && modified.empty() && removed.empty();
+		}
+	};
+	
 	/**
 	 * @brief Initializes the file and label lists.
 	 *
 	 * @pre This assumes the @a datasetPath points to a folder containing one
 	 * subfolder per class, with the subfolder name being the class name. Each
-	 * of these subfolders will contain all the images of that class.
+	 * of these subfolders will contain all the images of that class. The
+	 * subfolders are scanned in parallel.
 	 * @warning There should be more than @a trainImagesPerClass images on
 	 * each subfolder.
 	 * 
 	 * @param datasetPath The folder containing the dataset.
 	 * @param trainImagesPerClass Number of images for each class that will
 	 * be placed on the training set. The remainder will be used for testing.
+	 * @param seed Seed of the shuffle that splits the images. The same seed
+	 * always gives the same split.
+	 */
+	DatasetManager(std::string datasetPath,	unsigned int trainImagesPerClass,
+		uint64_t seed = 0);
+	
+	/**
+	 * @brief Provides the seed used to split the dataset.
+	 *
+	 * @return The seed given to the constructor.
 	 */
-	DatasetManager(std::string datasetPath,	unsigned int trainImagesPerClass);
+	uint64_t getSeed() const {
+		return m_seed;
+	}
 	
 	/**
 	 * @brief Utility function that extracts the file name from a file path.
@@ -57,13 +105,75 @@ public:
 		return m_classNames;
 	}
 	
+	/**
+	 * @brief Splits the dataset into folds, for cross-validation.
+	 *
+	 * The images of each class are spread evenly among the folds, in the
+	 * order given by the seed. The images of @a fold become the test set and
+	 * all the others the train set, regardless of the @a trainImagesPerClass
+	 * given to the constructor.
+	 *
+	 * @param fold The fold used for testing, from 0 to @a numFolds - 1.
+	 * @param numFolds The number of folds, at least 2.
+	 */
+	void setFold(unsigned int fold, unsigned int numFolds);
+	
+	/**
+	 * @brief Updates the file lists with the current contents of the folder.
+	 *
+	 * The files are matched by path. Files which are still present keep their
+	 * set, removed files are dropped and new files are shuffled with the seed
+	 * and added to the train set of their class until it holds
+	 * @a trainImagesPerClass images, and to the test set afterwards. Files
+	 * whose size or modification time changed keep their set, but are
+	 * reported so any data derived from them can be discarded.
+	 *
+	 * Datasets cached before the file times were recorded report no modified
+	 * files on their first refresh.
+	 *
+	 * @return The paths of the files which were added, modified or removed.
+	 */
+	Changes refresh();
+	
+	/**
+	 * @brief Provides the number of images in one of the sets.
+	 *
+	 * @param split The set of images.
+	 * @return The number of images in the set.
+	 */
+	unsigned int getNumImages(Split split) const {
+		return getSplit(split).size();
+	}
+	
+	/**
+	 * @brief Provides the path of one image.
+	 *
+	 * @param split The set the image belongs to.
+	 * @param index The position of the image in the shuffled set.
+	 * @return The path of the image file.
+	 */
+	std::string getImagePath(Split split, unsigned int index) const {
+		return getFilePath(getSplit(split)[index]);
+	}
+	
+	/**
+	 * @brief Provides the class of one image.
+	 *
+	 * @param split The set the image belongs to.
+	 * @param index The position of the image in the shuffled set.
+	 * @return The index of the image class in listClasses().
+	 */
+	unsigned int getImageClass(Split split, unsigned int index) const {
+		return m_fileClasses[getSplit(split)[index]];
+	}
+	
 	/**
 	 * @brief Lists the file paths of the train dataset.
 	 *
 	 * @return The shuffled list of files to be used on the classifier training.
 	 */
 	std::vector<std::string> getTrainData() const {
-		return m_trainFiles;
+		return listImagePaths(TRAIN);
 	}
 	
 	/**
@@ -73,7 +183,7 @@ public:
 	 * in the same order as the getTrainData() function.
 	 */
 	std::vector<unsigned int> getTrainClasses() const {
-		return m_trainClasses;
+		return listImageClasses(TRAIN);
 	}
 	
 	/**
@@ -82,34 +192,56 @@ public:
 	 * @return The shuffled list of files to be used on the classifier testing.
 	 */
 	std::vector<std::string> getTestData() const {
-		return m_testFiles;
+		return listImagePaths(TEST);
 	}
 	
 	/**
 	 * @brief Lists the image classes of the test dataset.
 	 *
 	 * @return The list of the image classes for the testing dataset
-	 * in the same order as the getTrainData() function.
+	 * in the same order as the getTestData() function.
 	 */
 	std::vector<unsigned int> getTestClasses() const {
-		return m_testClasses;
+		return listImageClasses(TEST);
 	}
 		
 private:
+	struct FileInfo {
+		std::string name;
+		uint64_t size;
+		int64_t time;
+	};
+	
 	void preloadFileLists();
-	void preloadClassFileList(std::string className,
-		boost::filesystem::path classDir);
-	std::vector<std::string> listFiles() const;
-	std::vector<unsigned int> getImageClasses() const;
+	void scanFolders(std::vector<std::string>& classNames,
+		std::vector<std::vector<FileInfo> >& classFiles) const;
+	std::string getClassDir(std::string className) const;
+	std::string getFilePath(uint32_t file) const;
+	std::vector<uint32_t> shuffleFiles() const;
+	void addFile(std::string fileName, unsigned int classIndex);
+	void addFile(const FileInfo& file, unsigned int classIndex);
+	std::vector<std::string> listImagePaths(Split split) const;
+	std::vector<unsigned int> listImageClasses(Split split) const;
+	
+	const std::vector<uint32_t>& getSplit(Split split) const {
+		return split == TRAIN ? m_trainFiles : m_testFiles;
+	}
 
 	std::string m_datasetPath;
+	uint64_t m_seed;
+	unsigned int m_trainImagesPerClass;
 	std::vector<std::string> m_classNames;
-	std::vector<std::pair<std::string, std::string> > m_classFiles;
+	std::vector<std::string> m_classDirs;
 	
-	std::vector<std::string> m_trainFiles;
-	std::vector<unsigned int> m_trainClasses;
-	std::vector<std::string> m_testFiles;
-	std::vector<unsigned int> m_testClasses;
+	// The names of all files, each one ending at the matching offset
+	std::string m_fileNames;
+	std::vector<uint32_t> m_fileNameEnds;
+	std::vector<uint16_t> m_fileClasses;
+	std::vector<uint64_t> m_fileSizes;
+	std::vector<int64_t> m_fileTimes;
+	
+	std::vector<uint32_t> m_trainFiles;
+	std::vector<uint32_t> m_testFiles;
 	
 	// Boost serialization
 	friend class boost::serialization::access;
@@ -117,14 +249,27 @@ private:
 	template<class Archive>
 	void serialize(Archive& ar, const unsigned int version)
 	{
+		// Older caches were shuffled with the clock and lack the files
+		// needed to refresh them, so they are discarded and split again
+		if(version < 3) {
+			throw std::runtime_error("dataset was cached by an old version");
+		}
+		
 		ar & m_datasetPath;
+		ar & m_seed;
 		ar & m_classNames;
-		ar & m_classFiles;
+		ar & m_classDirs;
+		ar & m_fileNames;
+		ar & m_fileNameEnds;
+		ar & m_fileClasses;
 		ar & m_trainFiles;
-		ar & m_trainClasses;
 		ar & m_testFiles;
-		ar & m_testClasses;
+		ar & m_trainImagesPerClass;
+		ar & m_fileSizes;
+		ar & m_fileTimes;
 	}
 };
 
+BOOST_CLASS_VERSION(DatasetManager, 3)
+
 #endif
@@ -3,15 +3,13 @@ using namespace std;
 using namespace boost;
 
 void printSvm(const char *s) {
-	std::string str(s);
-	if(str.find("optimization") != std::string::npos) {
-		boost::erase_all(str, "\n");
-		OutputHelper::printInlineMessage("Generating model - " + str, 1);
-	}
+	// The models of every class are trained at the same time, so their
+	// messages would be mixed. The progress is reported by SVMClassifier.
 }
 
 void printLinear(const char *s) {
-	cout << s;
+	// As with libsvm, the classes are trained at the same time and the
+	// progress is reported by LinearClassifier
 }
 
 int printVlfeat(char const *format, ...) {
@@ -36,6 +34,14 @@ void OutputHelper::disableOutput() {
 	cout.setstate(ios::failbit);
 }
 
+void OutputHelper::enableOutput() {
+	cout.clear();
+}
+
+bool OutputHelper::isOutputEnabled() {
+	return !cout.fail();
+}
+
 void OutputHelper::printInlineMessage(string message,
 		unsigned int indentLevel) {
 		
@@ -112,6 +118,23 @@ void OutputHelper::printConfusionMatrix(const vector<string>& classes,
 	cout << indent(2) << "Diagonal: " << diagonalAvg << "%" << endl;
 }
 
+void OutputHelper::printClassMetrics(const vector<string>& classes,
+		const vector<double>& precision, const vector<double>& recall) {
+	
+	int largestClassName = max_element(classes.begin(), classes.end(),
+		[](string a, string b) {return a.size() < b.size();})->size();
+	
+	cout << indent(1) << "Class Metrics:" << endl;
+	cout << indent(2) << setw(largestClassName) << " "
+		<< " Prec.  Rec." << endl;
+	for(unsigned int i = 0; i < classes.size(); i++) {
+		cout << indent(2) << setw(largestClassName) << classes[i]
+			<< setiosflags(ios::fixed) << setprecision(1)
+			<< " " << setw(5) << precision[i] * 100.0
+			<< " " << setw(5) << recall[i] * 100.0 << endl;
+	}
+}
+
 string OutputHelper::clearLine() {
 	stringstream ss;
 	ss << "\r" << setw(80) << " " << "\r";
@@ -28,6 +28,18 @@ public:
 	 * @brief Disable all console output.
 	 */
 	static void disableOutput();
+	
+	/**
+	 * @brief Enables the console output again, after disableOutput().
+	 */
+	static void enableOutput();
+
+	/**
+	 * @brief Returns whether the console output is enabled.
+	 *
+	 * @return @a false if disableOutput() was called.
+	 */
+	static bool isOutputEnabled();
 
 	/**
 	 * @brief Prints a single message, followed by a new line.
@@ -96,11 +108,28 @@ public:
 	 */
 	static void printConfusionMatrix(const std::vector<std::string>& classes, 
 		const boost::multi_array<float, 2>& data);
+	
+	/**
+	 * @brief Prints the precision and recall of each class.
+	 *
+	 * @param classes The class labels, one per row.
+	 * @param precision The precision of each class, between 0 and 1.
+	 * @param recall The recall of each class, between 0 and 1.
+	 */
+	static void printClassMetrics(const std::vector<std::string>& classes,
+		const std::vector<double>& precision,
+		const std::vector<double>& recall);
+
+	/**
+	 * @brief Generates the indentation inserted at the beginning of messages.
+	 *
+	 * @param level The number of indentation levels.
+	 * @return The string of spaces for that level.
+	 */
+	static std::string indent(int level);
 
 private:
 	static std::string clearLine();
-	
-	static std::string indent(int level);
 };
 
 void printSvm(const char *s);
@@ -0,0 +1,134 @@
+#include "Profiler.h"
+using namespace std;
+using namespace std::chrono;
+
+static const char* STAGE_NAMES[Profiler::NUM_STAGES] = {
+	"decode", "resize", "colour", "extract", "transform", "encode",
+	"classify", "cacheRead", "cacheWrite"
+};
+
+static const char* COUNTER_NAMES[Profiler::NUM_COUNTERS] = {
+	"cacheHits", "cacheMisses", "cacheCorrupt"
+};
+
+atomic<bool> Profiler::s_enabled(false);
+mutex Profiler::s_enableMutex;
+unsigned int Profiler::s_numEnabled = 0;
+Profiler::StageStats Profiler::s_stages[Profiler::NUM_STAGES];
+atomic<uint64_t> Profiler::s_counters[Profiler::NUM_COUNTERS];
+steady_clock::time_point Profiler::s_start = steady_clock::now();
+
+thread Profiler::s_streamThread;
+mutex Profiler::s_streamMutex;
+condition_variable Profiler::s_streamCondition;
+bool Profiler::s_streaming = false;
+
+Profiler::Timer::Timer(Stage stage) {
+	m_stage = stage;
+	m_active = isEnabled();
+	if(m_active) {
+		m_wallStart = steady_clock::now();
+		m_cpuStart = threadCpuNanos();
+	}
+}
+
+Profiler::Timer::~Timer() {
+	if(m_active) {
+		uint64_t wallNanos = duration_cast<nanoseconds>(
+			steady_clock::now() - m_wallStart).count();
+		uint64_t cpuNanos = threadCpuNanos() - m_cpuStart;
+
+		StageStats& stats = s_stages[m_stage];
+		stats.count.fetch_add(1, memory_order_relaxed);
+		stats.wallNanos.fetch_add(wallNanos, memory_order_relaxed);
+		stats.cpuNanos.fetch_add(cpuNanos, memory_order_relaxed);
+	}
+}
+
+bool Profiler::enable() {
+	lock_guard<mutex> lock(s_enableMutex);
+	if(s_numEnabled++ > 0) {
+		return false;
+	}
+	
+	for(unsigned int i = 0; i < NUM_STAGES; i++) {
+		s_stages[i].count = 0;
+		s_stages[i].wallNanos = 0;
+		s_stages[i].cpuNanos = 0;
+	}
+	for(unsigned int i = 0; i < NUM_COUNTERS; i++) {
+		s_counters[i] = 0;
+	}
+	s_start = steady_clock::now();
+	s_enabled = true;
+	return true;
+}
+
+bool Profiler::disable() {
+	lock_guard<mutex> lock(s_enableMutex);
+	if(s_numEnabled == 0 || --s_numEnabled > 0) {
+		return false;
+	}
+	
+	s_enabled = false;
+	return true;
+}
+
+void Profiler::increment(Counter counter, uint64_t amount) {
+	if(isEnabled()) {
+		s_counters[counter].fetch_add(amount, memory_order_relaxed);
+	}
+}
+
+void Profiler::writeJson(ostream& os) {
+	double elapsedMs = duration_cast<microseconds>(
+		steady_clock::now() - s_start).count() / 1000.0;
+
+	os << "{\"elapsedMs\": " << elapsedMs << ", \"stages\": {";
+	for(unsigned int i = 0; i < NUM_STAGES; i++) {
+		os << (i ? ", " : "") << "\"" << STAGE_NAMES[i] << "\": {"
+			<< "\"count\": " << s_stages[i].count.load() << ", "
+			<< "\"wallMs\": " << s_stages[i].wallNanos.load() / 1e6 << ", "
+			<< "\"cpuMs\": " << s_stages[i].cpuNanos.load() / 1e6 << "}";
+	}
+	os << "}, \"counters\": {";
+	for(unsigned int i = 0; i < NUM_COUNTERS; i++) {
+		os << (i ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": "
+			<< s_counters[i].load();
+	}
+	os << "}}";
+}
+
+void Profiler::startStreaming(string filename, double interval) {
+	stopStreaming();
+
+	s_streaming = true;
+	s_streamThread = thread([filename, interval]() {
+		ofstream ofs(filename, ios::app);
+		unique_lock<mutex> lock(s_streamMutex);
+		while(!s_streamCondition.wait_for(lock, duration<double>(interval),
+				[]() { return !s_streaming; })) {
+
+			writeJson(ofs);
+			ofs << endl;
+		}
+	});
+}
+
+void Profiler::stopStreaming() {
+	{
+		lock_guard<mutex> lock(s_streamMutex);
+		s_streaming = false;
+	}
+	s_streamCondition.notify_all();
+
+	if(s_streamThread.joinable()) {
+		s_streamThread.join();
+	}
+}
+
+uint64_t Profiler::threadCpuNanos() {
+	timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return time.tv_sec * 1000000000ull + time.tv_nsec;
+}
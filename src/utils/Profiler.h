@@ -0,0 +1,157 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Collects timings and counters for each stage of the classification.
+ *
+ * Every stage keeps the number of times it ran, along with the wall clock and
+ * CPU time spent in it. Both times are measured on the thread running the
+ * stage and summed over all threads, so they remain meaningful when the stages
+ * run in parallel. All the values are updated atomically.
+ *
+ * The profiler is disabled by default, in which case timing a stage only
+ * costs a relaxed atomic load. Each call to enable() must be matched by a call
+ * to disable(), and the values are collected while any of them is pending, so
+ * nested users share a single profile.
+ */
+class Profiler {
+public:
+	/**
+	 * @brief The stages that can be timed.
+	 */
+	enum Stage {
+		DECODE,      /**< reading and decoding an image file */
+		RESIZE,      /**< resizing an image to the maximum resolution */
+		COLOUR,      /**< converting an image to its colour space */
+		EXTRACT,     /**< extracting the features of an image */
+		TRANSFORM,   /**< transforming and compacting the features */
+		ENCODE,      /**< encoding the features into an histogram */
+		CLASSIFY,    /**< classifying an histogram */
+		CACHE_READ,  /**< loading an item from the cache */
+		CACHE_WRITE, /**< saving an item to the cache */
+		NUM_STAGES
+	};
+
+	/**
+	 * @brief The events that can be counted.
+	 */
+	enum Counter {
+		CACHE_HITS,    /**< items found in the cache */
+		CACHE_MISSES,  /**< items missing from the cache */
+		CACHE_CORRUPT, /**< damaged items removed from the cache */
+		NUM_COUNTERS
+	};
+
+	/**
+	 * @brief Times a stage from its construction until its destruction.
+	 */
+	class Timer {
+	public:
+		/**
+		 * @brief Starts timing a stage, if the profiler is enabled.
+		 *
+		 * @param stage The stage being timed.
+		 */
+		Timer(Stage stage);
+		~Timer();
+
+	private:
+		Stage m_stage;
+		bool m_active;
+		std::chrono::steady_clock::time_point m_wallStart;
+		uint64_t m_cpuStart;
+	};
+
+	/**
+	 * @brief Starts collecting values, if the profiler is not enabled yet.
+	 *
+	 * The values are cleared when collection starts.
+	 *
+	 * @return @a true if this call started the collection.
+	 */
+	static bool enable();
+
+	/**
+	 * @brief Releases a call to enable().
+	 *
+	 * Once every call was released, the profiler stops collecting values,
+	 * keeping the ones already collected.
+	 *
+	 * @return @a true if this call stopped the collection.
+	 */
+	static bool disable();
+
+	/**
+	 * @brief Returns whether the profiler is collecting values.
+	 *
+	 * @return @a true if the profiler is enabled.
+	 */
+	static bool isEnabled() {
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Increments one of the counters, if the profiler is enabled.
+	 *
+	 * @param counter The counter to be incremented.
+	 * @param amount How much to add to the counter.
+	 */
+	static void increment(Counter counter, uint64_t amount = 1);
+
+	/**
+	 * @brief Writes all the collected values as a single JSON object.
+	 *
+	 * @param os The stream to write to.
+	 */
+	static void writeJson(std::ostream& os);
+
+	/**
+	 * @brief Periodically appends the collected values to a file.
+	 *
+	 * Each snapshot is written as one JSON object per line by a background
+	 * thread, until stopStreaming() is called.
+	 *
+	 * @param filename The file the snapshots are appended to.
+	 * @param interval The number of seconds between snapshots.
+	 */
+	static void startStreaming(std::string filename, double interval);
+
+	/**
+	 * @brief Stops the periodic snapshots started by startStreaming().
+	 */
+	static void stopStreaming();
+
+private:
+	struct StageStats {
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> wallNanos;
+		std::atomic<uint64_t> cpuNanos;
+	};
+
+	static std::atomic<bool> s_enabled;
+	static std::mutex s_enableMutex;
+	static unsigned int s_numEnabled;
+	static StageStats s_stages[NUM_STAGES];
+	static std::atomic<uint64_t> s_counters[NUM_COUNTERS];
+	static std::chrono::steady_clock::time_point s_start;
+
+	static std::thread s_streamThread;
+	static std::mutex s_streamMutex;
+	static std::condition_variable s_streamCondition;
+	static bool s_streaming;
+
+	static uint64_t threadCpuNanos();
+};
+
+#endif
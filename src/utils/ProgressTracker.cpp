@@ -0,0 +1,62 @@
+#include "ProgressTracker.h"
+using namespace std;
+
+atomic<double> ProgressTracker::s_interval(0.5);
+
+ProgressTracker::ProgressTracker(string message, unsigned int total,
+		unsigned int indentLevel) : m_current(0), m_result(0), m_value(0.0f),
+		m_hasResult(false) {
+
+	m_message = message;
+	m_total = total;
+	m_indentLevel = indentLevel;
+	m_done = false;
+
+	// Nothing would be shown if the output is disabled, so skip the thread
+	double interval = s_interval.load();
+	m_enabled = interval > 0.0 && OutputHelper::isOutputEnabled();
+	if(m_enabled) {
+		m_reporter = thread([this, interval]() {
+			unique_lock<mutex> lock(m_mutex);
+			while(!m_condition.wait_for(lock,
+					chrono::duration<double>(interval),
+					[this]() { return m_done; })) {
+				
+				// The completed task is only reported once, by the destructor
+				if(m_current.load(memory_order_relaxed) < m_total) {
+					report();
+				}
+			}
+		});
+	}
+}
+
+ProgressTracker::~ProgressTracker() {
+	if(m_enabled) {
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_done = true;
+		}
+		m_condition.notify_all();
+		m_reporter.join();
+		if(m_total > 0) {
+			report();
+		}
+	}
+}
+
+void ProgressTracker::setInterval(double interval) {
+	s_interval = interval;
+}
+
+void ProgressTracker::report() const {
+	unsigned int current = m_current.load(memory_order_relaxed);
+	if(m_hasResult.load(memory_order_relaxed)) {
+		OutputHelper::printResults(m_message, current, m_total,
+			m_result.load(memory_order_relaxed),
+			m_value.load(memory_order_relaxed), m_indentLevel);
+	} else {
+		OutputHelper::printProgress(m_message, current, m_total,
+			m_indentLevel);
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef PROGRESS_TRACKER_H
+#define PROGRESS_TRACKER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "utils/OutputHelper.h"
+
+/**
+ * @brief Reports the progress of a parallel loop without serializing it.
+ *
+ * The worker threads only increment an atomic counter. A separate reporter
+ * thread prints the progress through OutputHelper at a fixed interval, so
+ * the amount of output does not depend on the number of items or threads.
+ *
+ * Reporting can be turned off for every tracker with setInterval(), in which
+ * case no reporter thread is started and nothing is printed.
+ */
+class ProgressTracker {
+public:
+	/**
+	 * @brief Starts tracking a task.
+	 *
+	 * @param message Message describing the task.
+	 * @param total The total number of items of the task.
+	 * @param indentLevel How many tab characters to insert at the beginning
+	 * of the message.
+	 */
+	ProgressTracker(std::string message, unsigned int total,
+		unsigned int indentLevel = 1);
+
+	/**
+	 * @brief Stops the reporter thread and prints the final progress.
+	 */
+	~ProgressTracker();
+
+	/**
+	 * @brief Marks one item as completed.
+	 */
+	void increment() {
+		m_current.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Marks one classified item as completed.
+	 *
+	 * The class and decision value of the latest item are shown along
+	 * with the progress.
+	 *
+	 * @param result The chosen class for the item.
+	 * @param value The decision value for the chosen class.
+	 */
+	void increment(int result, float value) {
+		m_result.store(result, std::memory_order_relaxed);
+		m_value.store(value, std::memory_order_relaxed);
+		m_hasResult.store(true, std::memory_order_relaxed);
+		increment();
+	}
+
+	/**
+	 * @brief Sets how often every tracker reports its progress.
+	 *
+	 * @param interval The number of seconds between reports. Zero disables
+	 * the progress output.
+	 */
+	static void setInterval(double interval);
+
+private:
+	std::string m_message;
+	unsigned int m_total;
+	unsigned int m_indentLevel;
+
+	std::atomic<unsigned int> m_current;
+	std::atomic<int> m_result;
+	std::atomic<float> m_value;
+	std::atomic<bool> m_hasResult;
+
+	bool m_enabled;
+	bool m_done;
+	std::thread m_reporter;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+
+	static std::atomic<double> s_interval;
+
+	void report() const;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include "ShardStore.h"
+using namespace std;
+
+// Every shard starts with a header holding the time its extraction started,
+// and every entry with a header holding its length and the CRC-32 of the
+// length and the archive
+static const char SHARD_MAGIC[4] = {'D', 'N', 'S', 'H'};
+static const char ENTRY_MAGIC[4] = {'D', 'N', 'S', '1'};
+
+struct ShardHeader {
+	char magic[4];
+	uint32_t reserved;
+	int64_t startTime;
+};
+
+struct EntryHeader {
+	char magic[4];
+	uint32_t crc;
+	uint64_t length;
+};
+
+static uint32_t getChecksum(const EntryHeader& header, const char* data) {
+	boost::crc_32_type crc;
+	crc.process_bytes(&header.length, sizeof(header.length));
+	crc.process_bytes(data, header.length);
+	return crc.checksum();
+}
+
+ShardStore::ShardStore(const CacheHelper* cacheHelper, unsigned int shard,
+		unsigned int numShards) {
+
+	if(numShards == 0 || shard >= numShards) {
+		throw invalid_argument("Invalid shard " + to_string(shard) + " of " +
+			to_string(numShards));
+	}
+	if(!cacheHelper->isEnabled()) {
+		throw runtime_error("shards are merged into the cache, which is "
+			"disabled by framework.cacheData");
+	}
+
+	m_cacheHelper = cacheHelper;
+	m_shard = shard;
+	m_numShards = numShards;
+	m_startTime = time(nullptr);
+}
+
+ShardStore::~ShardStore() {
+	close();
+	
+	// A destructor must not throw, the data left behind is never merged
+	boost::system::error_code error;
+	for(unsigned int i = 0; i < m_filenames.size(); i++) {
+		boost::filesystem::remove(m_filenames[i] + ".tmp", error);
+	}
+}
+
+unsigned int ShardStore::getShard(string filePath, unsigned int numShards) {
+	// 64 bit FNV-1a hash of the path
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for(unsigned int i = 0; i < filePath.size(); i++) {
+		hash ^= (unsigned char) filePath[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash % numShards;
+}
+
+void ShardStore::commit() {
+	lock_guard<mutex> lock(m_mutex);
+	if(!close()) {
+		throw runtime_error("could not write shard " + getShardName() +
+			", it was discarded");
+	}
+	for(unsigned int i = 0; i < m_filenames.size(); i++) {
+		boost::filesystem::rename(m_filenames[i] + ".tmp", m_filenames[i]);
+	}
+	m_filenames.clear();
+}
+
+string ShardStore::getShardName(unsigned int shard, unsigned int numShards) {
+	return "shard-" + to_string(shard) + "-of-" + to_string(numShards);
+}
+
+void ShardStore::writeHeader(ostream& os, int64_t startTime) {
+	ShardHeader header;
+	memcpy(header.magic, SHARD_MAGIC, sizeof(SHARD_MAGIC));
+	header.reserved = 0;
+	header.startTime = startTime;
+	os.write((const char*) &header, sizeof(header));
+}
+
+bool ShardStore::readHeader(istream& is, int64_t& startTime) {
+	ShardHeader header;
+	if(!is.read((char*) &header, sizeof(header)) ||
+			memcmp(header.magic, SHARD_MAGIC, sizeof(SHARD_MAGIC)) != 0) {
+		return false;
+	}
+	startTime = header.startTime;
+	return true;
+}
+
+bool ShardStore::isStale(string filename, int64_t startTime) {
+	// A time equal to the start could be from just after it, the times only
+	// have a resolution of one second
+	boost::system::error_code error;
+	int64_t modified = boost::filesystem::last_write_time(filename, error);
+	return error || modified >= startTime;
+}
+
+void ShardStore::writeEntry(ostream& os, const string& payload) {
+	EntryHeader header;
+	memcpy(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+	header.length = payload.size();
+	header.crc = getChecksum(header, payload.data());
+	
+	os.write((const char*) &header, sizeof(header));
+	os.write(payload.data(), payload.size());
+}
+
+bool ShardStore::readEntry(istream& is, string& payload, bool& intact) {
+	EntryHeader header;
+	if(!is.read((char*) &header, sizeof(header)) ||
+			memcmp(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) != 0) {
+		return false;
+	}
+	
+	// A damaged length loses the position of the entries after it
+	streampos start = is.tellg();
+	is.seekg(0, ios::end);
+	uint64_t remaining = is.tellg() - start;
+	is.seekg(start);
+	if(header.length > remaining) {
+		return false;
+	}
+	
+	payload.resize(header.length);
+	if(!is.read(&payload[0], header.length)) {
+		return false;
+	}
+	intact = getChecksum(header, payload.data()) == header.crc;
+	return true;
+}
+
+bool ShardStore::close() {
+	bool written = true;
+	for(map<type_index, ofstream*>::iterator it = m_outputs.begin();
+			it != m_outputs.end(); it++) {
+
+		it->second->close();
+		written = written && !it->second->fail();
+		delete it->second;
+	}
+	m_outputs.clear();
+	return written;
+}
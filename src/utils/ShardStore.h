@@ -0,0 +1,258 @@
+#ifndef SHARD_STORE_H
+#define SHARD_STORE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <typeinfo>
+#include <typeindex>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/crc.hpp>
+
+#include "utils/CacheHelper.h"
+
+/**
+ * @brief Collects the data generated by one of several processes.
+ *
+ * The images of a dataset can be split into shards, each one processed by a
+ * different process, possibly on different machines sharing the cache
+ * folder. Instead of writing one cache file per image, every process appends
+ * its data to a single file per type, which only becomes visible, under its
+ * final name, once commit() is called. The shards are then merged into the
+ * regular cache by a single process with merge().
+ *
+ * Each entry is written as a separate Boost archive, so entries never
+ * reference each other and the file can be read back one entry at a time.
+ * Like the entries of the cache, every archive is preceded by its length and
+ * CRC-32, so a damaged entry is skipped when merging instead of stopping the
+ * merge or being stored in the cache.
+ *
+ * The name of each entry must be the path of the image it was generated
+ * from. Every shard records when its extraction started, and the entries of
+ * images modified or removed since then are skipped when merging, so the
+ * data of an image changed between the extraction and the merge is never
+ * stored in the cache. Those images are processed again when needed.
+ */
+class ShardStore {
+public:
+	/**
+	 * @brief Opens the store of one shard.
+	 *
+	 * @param cacheHelper The cache the shard will be merged into.
+	 * @param shard The index of the shard, from 0 to @a numShards - 1.
+	 * @param numShards The number of shards the dataset is split into.
+	 */
+	ShardStore(const CacheHelper* cacheHelper, unsigned int shard,
+		unsigned int numShards);
+
+	/**
+	 * @brief Discards any data which was not committed.
+	 */
+	~ShardStore();
+
+	/**
+	 * @brief Chooses the shard a file belongs to.
+	 *
+	 * The choice only depends on the path, so every process agrees on it and
+	 * it does not change when other files are added to the dataset.
+	 *
+	 * @param filePath The path of the file.
+	 * @param numShards The number of shards.
+	 * @return The index of the shard.
+	 */
+	static unsigned int getShard(std::string filePath, unsigned int numShards);
+
+	/**
+	 * @brief Appends an entry to the shard.
+	 *
+	 * This can be called from several threads at the same time. Once a write
+	 * failed, such as when the disk is full, the entries are no longer
+	 * written and commit() fails.
+	 *
+	 * @param filename The path of the image the data was generated from, the
+	 * same name used with CacheHelper.
+	 * @param data The data item to be stored.
+	 */
+	template <typename T> void add(std::string filename, T* data) {
+		std::ostringstream oss;
+		{
+			boost::archive::binary_oarchive oa(oss);
+			oa << filename;
+			oa << data;
+		}
+		
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::ofstream* output = getOutput<T>();
+		if(output->good()) {
+			writeEntry(*output, oss.str());
+		}
+	}
+
+	/**
+	 * @brief Creates the file of a type of data, even if it stays empty.
+	 *
+	 * This lets merge() tell a shard with nothing new apart from a shard
+	 * which was never processed.
+	 */
+	template <typename T> void open() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		getOutput<T>();
+	}
+
+	/**
+	 * @brief Closes the shard and makes it visible under its final name.
+	 *
+	 * A shard missing any of its entries is never made visible. Instead a
+	 * std::runtime_error is thrown and the shard is discarded when the store
+	 * is destroyed.
+	 */
+	void commit();
+
+	/**
+	 * @brief Moves the data of every shard of a type into the cache.
+	 *
+	 * The shard files are deleted once their data is in the cache.
+	 *
+	 * @param cacheHelper The cache the shards were created for.
+	 * @param numShards The number of shards the dataset was split into.
+	 * @param required If enabled, a shard which was never opened for this
+	 * type is an error. Otherwise the shards which are present are merged
+	 * and the others ignored.
+	 * @return The number of entries merged.
+	 */
+	template <typename T> static unsigned int merge(
+			const CacheHelper* cacheHelper, unsigned int numShards,
+			bool required) {
+
+		// Nothing is merged unless every shard is there
+		std::string folder = cacheHelper->getShardFolder<T>();
+		for(unsigned int i = 0; i < numShards && required; i++) {
+			std::string shardFilename = folder + getShardName(i, numShards);
+			if(!boost::filesystem::exists(shardFilename)) {
+				throw std::runtime_error("missing shard " + shardFilename);
+			}
+		}
+
+		unsigned int numEntries = 0;
+		for(unsigned int i = 0; i < numShards; i++) {
+			std::string shardFilename = folder + getShardName(i, numShards);
+			if(!boost::filesystem::exists(shardFilename)) {
+				continue;
+			}
+
+			// The damaged entries are left out of the cache, so their images
+			// are processed again when needed
+			unsigned int numDamaged = 0;
+			unsigned int numStale = 0;
+			std::ifstream ifs(shardFilename, std::ios::binary);
+			int64_t startTime;
+			if(!readHeader(ifs, startTime)) {
+				numDamaged++;
+			}
+			while(numDamaged == 0 &&
+					ifs.peek() != std::ifstream::traits_type::eof()) {
+				std::string payload;
+				bool intact;
+				if(!readEntry(ifs, payload, intact)) {
+					numDamaged++;
+					break;
+				}
+				
+				std::string filename;
+				T* data = intact ? parseEntry<T>(payload, filename) : nullptr;
+				if(data == nullptr) {
+					numDamaged++;
+					continue;
+				}
+				if(isStale(filename, startTime)) {
+					numStale++;
+				} else {
+					cacheHelper->save<T>(filename, data);
+					numEntries++;
+				}
+				delete data;
+			}
+			ifs.close();
+			boost::filesystem::remove(shardFilename);
+			
+			if(numDamaged > 0) {
+				OutputHelper::printMessage("Skipped " +
+					std::to_string(numDamaged) + " damaged entries of " +
+					shardFilename);
+			}
+			if(numStale > 0) {
+				OutputHelper::printMessage("Skipped " +
+					std::to_string(numStale) + " entries of images changed "
+					"since the extraction of " + shardFilename);
+			}
+		}
+		return numEntries;
+	}
+
+private:
+	const CacheHelper* m_cacheHelper;
+	unsigned int m_shard;
+	unsigned int m_numShards;
+	int64_t m_startTime;
+
+	std::mutex m_mutex;
+	std::map<std::type_index, std::ofstream*> m_outputs;
+	std::vector<std::string> m_filenames;
+
+	template <typename T> std::ofstream* getOutput() {
+		std::ofstream*& ofs = m_outputs[std::type_index(typeid(T))];
+		if(ofs == nullptr) {
+			std::string folder = m_cacheHelper->getShardFolder<T>();
+			boost::filesystem::create_directories(folder);
+			std::string shardFilename = folder + getShardName();
+			m_filenames.push_back(shardFilename);
+			ofs = new std::ofstream(shardFilename + ".tmp", std::ios::binary);
+			writeHeader(*ofs, m_startTime);
+		}
+		return ofs;
+	}
+
+	std::string getShardName() const {
+		return getShardName(m_shard, m_numShards);
+	}
+
+	static std::string getShardName(unsigned int shard,
+		unsigned int numShards);
+
+	static void writeHeader(std::ostream& os, int64_t startTime);
+	static bool readHeader(std::istream& is, int64_t& startTime);
+	static bool isStale(std::string filename, int64_t startTime);
+	static void writeEntry(std::ostream& os, const std::string& payload);
+	static bool readEntry(std::istream& is, std::string& payload,
+		bool& intact);
+
+	template <typename T> static T* parseEntry(const std::string& payload,
+			std::string& filename) {
+		
+		T* data = nullptr;
+		try {
+			std::istringstream iss(payload);
+			boost::archive::binary_iarchive ia(iss);
+			ia >> filename;
+			ia >> data;
+		} catch(...) {
+			delete data;
+			data = nullptr;
+		}
+		return data;
+	}
+
+	bool close();
+};
+
+#endif